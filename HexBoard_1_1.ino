@@ -6,7 +6,7 @@ enum class App_state {  // OLED             LED         Audio        Keys
   play_mode,            // full GUI         musical     active       play       control, hold for menu
   menu_nav,             // menu             musical     active       play       menu, hold at home page to escape
   edit_mode,            // menu->edit mode  edit mode   off          selection  menu
-  calibrate,            // TBD
+  calibrate,            // instructions     musical     off          sampling   click to save, hold to cancel
   data_mgmt,            // TBD
   crash,                // display error    off         off          off        TBD
   low_power,            // off              off         off          off        off, except hold to awake
@@ -23,7 +23,13 @@ volatile int screenupdate = 0;
 #include "src/settings.h"
 hexBoard_Setting_Array settings;
 #include "src/file_system.h"
+hexBoard_Settings_Saver settings_saver;
+#include "src/latency.h"
+hexBoard_Latency_Object latency;
 const char* settingFileName = "temp222.dat";
+const char* calibrationFileName = "keycal.dat";
+const char* scalaFileName = "tuning.scl";
+const char* keyboardMapFileName = "tuning.kbm";
 
 #include "src/synth.h"
 hexBoard_Synth_Object  synth(synthPins, 2);
@@ -31,58 +37,62 @@ hexBoard_Synth_Object  synth(synthPins, 2);
 hexBoard_Rotary_Object rotary(rotaryPinA, rotaryPinB, rotaryPinC);
 #include "src/keys.h"
 hexBoard_Key_Object    keys(muxPins, colPins, analogPins);
+#include "src/executive.h"
+hexBoard_Executive_Object executive;
 
-bool on_callback_synth(struct repeating_timer *t) {
-  synth.poll();
-  return true;
-}
-bool on_callback_rotary(struct repeating_timer *t) {
-  rotary.poll();
-  return true;
+void on_rotary_turn_edge() {
+  rotary.on_turn_edge();
 }
-bool on_callback_keys(struct repeating_timer *t) {
-  keys.poll();
-  return true;
+void on_rotary_click_edge() {
+  rotary.on_click_edge();
 }
 
 void start_background_processes() {
-  alarm_pool_t *core1pool;
-  core1pool = alarm_pool_create(1, 4);
-  
+  // so that core0 can park this core during flash writes
+  multicore_lockout_victim_init();
+  core1_lockout_ready = true;
   synth.begin();
-  struct repeating_timer timer_synth;
-  // enter a negative timer value here because the poll
-  // should occur X microseconds after the routine starts
-  alarm_pool_add_repeating_timer_us(core1pool, 
-    -audio_sample_interval_uS, on_callback_synth, 
-    NULL, &timer_synth);
-
   rotary.begin();
-  struct repeating_timer timer_rotary;
-  // enter a positive timer value here because the poll
-  // should occur X microseconds after the routine finishes
-  alarm_pool_add_repeating_timer_us(core1pool,
-    rotary_poll_interval_uS, on_callback_rotary,
-    NULL, &timer_rotary);
+  // the knob is decoded from pin-change interrupts instead
+  // of a timer. attach them here so that core1 services them.
+  attachInterrupt(digitalPinToInterrupt(rotaryPinA), on_rotary_turn_edge,  CHANGE);
+  attachInterrupt(digitalPinToInterrupt(rotaryPinB), on_rotary_turn_edge,  CHANGE);
+  attachInterrupt(digitalPinToInterrupt(rotaryPinC), on_rotary_click_edge, CHANGE);
 
   keys.begin();
-  struct repeating_timer timer_keys;
-  // enter a positive timer value here because the poll
-  // should occur X microseconds after the routine finishes
-  alarm_pool_add_repeating_timer_us(core1pool, 
-    key_poll_interval_uS, on_callback_keys, 
-    NULL, &timer_keys);
 
-  while (1) {}
-  // once these objects are run, then core_1 will
-  // run background processes only
+  // from here core1 runs background processes only,
+  // one audio sample per frame. the sample always comes
+  // first, on a fixed grid; then at most one other slot
+  // runs in the gap before the next sample, if it fits.
+  // the keys and knob are next due a set time after they
+  // finish, which is how the key scan rate adapts.
+  executive.begin();
+  while (1) {
+    executive.wait_for_tick();
+    synth.poll();
+    if (executive.slot_ready(_exec_slot_keys)) {
+      keys.poll();
+      executive.finish_slot(_exec_slot_keys, keys.poll_interval());
+    } else if (executive.slot_ready(_exec_slot_rotary)) {
+      rotary.poll();
+      executive.finish_slot(_exec_slot_rotary, rotary_poll_interval_uS);
+    }
+    executive.end_frame();
+  }
 }
 
 #include "src/synth.h"  // direct digital synthesis math
 #include "src/music.h"  // microtonal and MIDI math
 #include "src/MIDI_and_USB.h"
 #include "src/hexBoard.h"
-hexBoard_Grid_Object   hexBoard(hexBoard_layout_v1_2);
+hexBoard_Grid_Object   hexBoard(hexBoard_layout_v1_2, hexBoard_lookup_v1_2);
+#include "src/MTS.h"
+hexBoard_MTS_Object    mts;
+#include "src/MPE.h"
+hexBoard_MPE_Object    mpe;
+#include "src/scala.h"
+hexBoard_Scala_Object  scala;
 
 #include "src/LED.h"
 #include "src/OLED.h"
@@ -91,12 +101,14 @@ OLED_screensaver       oled_screensaver(default_contrast, screensaver_contrast);
 #include "src/menu.h"
 #include "src/GUI.h"
 #include "src/layout.h"
+#include "src/preset.h"
 
 void hardwired_switch_handler(int16_t ID) {
   switch (ID) {
     case 140: {
       if (settings[_defaults].b) { // if you have not loaded existing settings
         load_factory_defaults_to(settings, 12); // replace with v1.2 firmware defaults
+        settings_saver.mark_all(settings);
       }
     }
     default:
@@ -115,55 +127,149 @@ void set_audio_outs_from_settings(hexBoard_Setting_Array& refS) {
 void calibrate_rotary_from_settings(hexBoard_Setting_Array& refS) {
   rotary.recalibrate(refS[_rotInv].b, refS[_rotLongP].i, refS[_rotDblCk].i);
 }
+// voices hold a pointer to the table they play, so a new
+// waveform is built in the spare table and swapped in, and
+// held notes are moved over before the old one is reused.
 void pre_cache_synth_waveform(hexBoard_Setting_Array& refS) {
+  wave_tbl& w = hexBoard.spare_waveform();
   switch (refS[_synthWav].i) {
     case _synthWav_square:
-      hexBoard.cached_waveform = linear_waveform(1.f, Linear_Wave::square, 0);
+      w = linear_waveform(0, Linear_Wave::square, 0);
       break;
     case _synthWav_saw:
-      hexBoard.cached_waveform = linear_waveform(1.f, Linear_Wave::saw, 0);
+      w = linear_waveform(0, Linear_Wave::saw, 0);
       break;
     case _synthWav_triangle:
-      hexBoard.cached_waveform = linear_waveform(1.f, Linear_Wave::triangle, 0);
+      w = linear_waveform(0, Linear_Wave::triangle, 0);
       break;
     case _synthWav_sine:
-      hexBoard.cached_waveform = additive_synthesis(1, sineAmt, sinePhase);
+      w = additive_synthesis(1, sineAmt, sinePhase);
       break;
     case _synthWav_strings:
-      hexBoard.cached_waveform = additive_synthesis(10, stringsAmt, stringsPhase);
+      w = additive_synthesis(10, stringsAmt, stringsPhase);
       break;
     case _synthWav_clarinet:
-      hexBoard.cached_waveform = additive_synthesis(11, clarinetAmt, clarinetPhase);
+      w = additive_synthesis(11, clarinetAmt, clarinetPhase);
       break;
+    case _synthWav_hybrid:
+      // rebuilt with the same contents every time, so
+      // a voice playing from it never hears a change
+      build_hybrid_wave_bank(hexBoard.hybrid_bank);
+      return;
     default:
-      break;
+      return;
   } 
+  const int8_t* old = hexBoard.swap_waveform();
+  synth.retarget_wavetable(old, hexBoard.wavetable(0));
+}
+void set_synth_envelope_from_settings(hexBoard_Setting_Array& refS) {
+  switch (refS[_synthEnv].i) {
+    case _synthEnv_hit:
+      synth.envelope.set(20/*ms*/, 50/*ms*/, 128/*0-255*/, 100/*ms*/);
+      break;
+    case _synthEnv_pluck:
+      synth.envelope.set(20/*ms*/, 1000/*ms*/, 24/*0-255*/, 100/*ms*/);
+      break;
+    case _synthEnv_strum:
+      synth.envelope.set(50/*ms*/, 2000/*ms*/, 128/*0-255*/, 500/*ms*/);
+      break;
+    case _synthEnv_slow:
+      synth.envelope.set(1000/*ms*/, 0/*ms*/, 255/*0-255*/, 1000/*ms*/);
+      break;
+    case _synthEnv_reverse:
+      synth.envelope.set(2000/*ms*/, 0/*ms*/, 0/*0-255*/, 0/*ms*/);
+      break;
+    default:
+      synth.envelope.set(0, 0, 255, 0);
+      break;
+  }
+}
+// end the MIDI note of every held key, whichever mode
+// it was started in, before the MIDI mode or zones change.
+// the key itself plays on, silent on MIDI until re-pressed.
+void release_held_MIDI_notes(hexBoard_Setting_Array& refS) {
+  for (size_t p = 0; p < keys_count; ++p) {
+    Button b = hexBoard.button_at_pixel(p);
+    uint8_t ch = b.play.midiChPlaying;
+    if (!ch) continue;
+    if (mpe.owns(b, ch)) {
+      mpe.note_off(refS, b);
+    } else {
+      send_note_off(refS, b.play.midiNotePlaying, 0, ch);
+      b.play.midiChPlaying = 0;
+    }
+  }
+}
+void configure_MIDI_from_settings(hexBoard_Setting_Array& refS) {
+  release_held_MIDI_notes(refS);
+  if (refS[_MIDImode].i == _MIDImode_MPE) {
+    mpe.configure(refS);
+  }
+}
+// scala files are read when a layout is generated from them,
+// not on every layout update
+void load_tuning_files(hexBoard_Setting_Array& refS) {
+  if (refS[_tuneSys].i != _tuneSys_scala) return;
+  // the keyboard map's reference note can move the anchor
+  int     anchorN = refS[_anchorN].i;
+  double  anchorC = refS[_anchorC].d;
+  scala.load(refS, scalaFileName, keyboardMapFileName);
+  if (refS[_anchorN].i != anchorN) settings_saver.mark(refS, _anchorN);
+  if (refS[_anchorC].d != anchorC) settings_saver.mark(refS, _anchorC);
 }
 void apply_settings_to_objects(hexBoard_Setting_Array& refS) {
+  // MIDI 2.0 is no longer offered; a file saved with it plays normal MIDI
+  if (refS[_MIDImode].i == _MIDImode_2_point_oh) {
+    refS[_MIDImode].i = _MIDImode_standard;
+    settings_saver.mark(refS, _MIDImode);
+  }
   set_audio_outs_from_settings(refS);
   calibrate_rotary_from_settings(refS);
   pre_cache_synth_waveform(refS); 
+  set_synth_envelope_from_settings(refS);
+  load_tuning_files(refS);
   generate_layout(refS);
+  configure_MIDI_from_settings(refS);
 }
 void menu_handler(int settingNumber) {
   switch (settingNumber) {
     case _run_routine_to_generate_layout:
+      load_tuning_files(settings);
       generate_layout(settings);
       menu.setMenuPageCurrent(pgHome);
       break;
+    case _run_routine_to_calibrate_keys:
+      keys.start_calibration();
+      menu.setMenuPageCurrent(pgNoMenu);
+      app_state = App_state::calibrate;
+      break;
     
     case _txposeS: case _txposeC:
-      // recalculate pitches for everyone
+      update_layout(settings, _layout_stage_pitch);
+      break;
+    case _palette:
+      update_layout(settings, _layout_stage_colors);
       break;
     case _scaleLck:
-      // set scale lock as appropriate
+      update_layout(settings, _layout_stage_lock);
       break;
     case _rotInv: case _rotDblCk: case _rotLongP:
       calibrate_rotary_from_settings(settings);
       break;
     case _MIDIusb: case _MIDIjack:
       // turn MIDI jacks on/off
+      // a port that was just switched on needs the tuning table
+      mts.invalidate();
+      update_layout(settings, _layout_stage_MIDI);
+      configure_MIDI_from_settings(settings);
       break;    
+    case _MIDImode: case _MPEpb:
+      update_layout(settings, _layout_stage_MIDI);
+      configure_MIDI_from_settings(settings);
+      break;
+    case _MPEzoneC: case _MPEzoneL: case _MPEzoneR:
+      configure_MIDI_from_settings(settings);
+      break;
     case _synthBuz: case _synthJac:
       set_audio_outs_from_settings(settings);
       break;    
@@ -172,11 +278,16 @@ void menu_handler(int settingNumber) {
       break;
     case _synthWav:
       pre_cache_synth_waveform(settings); 
-      // precalculate active waveform and cache?
+      update_layout(settings, _layout_stage_synth);
+      break;
+    case _synthVol:
+      update_layout(settings, _layout_stage_synth);
+      break;
+    case _synthEnv:
+      set_synth_envelope_from_settings(settings);
       break;
     /*
     _animFPS,  //
-    _palette,  //
     _animType, //
     _globlBrt, //
     _hueLoop,  //
@@ -188,11 +299,6 @@ void menu_handler(int settingNumber) {
     _mdSpeed,  //
     _pbSpeed,  //
     _vlSpeed,  //
-    _MIDImode, //
-    _MPEzoneC, //
-    _MPEzoneL, //
-    _MPEzoneR, //
-    _MPEpb,    //
     _synthTyp, //
     */
     default: 
@@ -200,111 +306,191 @@ void menu_handler(int settingNumber) {
   }
 }
 
-void interpret_key_msg(Key_Msg& msg) {
-  Button* b = &(hexBoard.button_at_linear_index(msg.switch_number));
-  b->update_levels(msg.timestamp, msg.level);
-  if (b->check_and_reset_just_pressed()) {
-    if (!b->isBtn) {
-      hardwired_switch_handler(b->pixel);
+void preset_handler(int slot, bool save) {
+  if (save) {
+    save_layout_preset(settings, hexBoard, slot);
+    return;
+  }
+  uint32_t start_time = timer_hw->timerawl;
+  if (!load_layout_preset(settings, hexBoard, slot)) return;
+  settings_saver.mark_all(settings);
+  // these depend on settings the preset does not carry
+  update_layout(settings, _layout_stage_MIDI | _layout_stage_synth | _layout_stage_lock);
+  debug.trace(_trace_preset_loaded, timer_hw->timerawl - start_time);
+}
+
+// take a voice from the open queue and start it.
+// returns the synth channel, or 0 if every voice is busy.
+// pitch, loudness and wavetable were all worked out with
+// the layout, so only the velocity is applied here.
+uint8_t start_synth_voice(const Synth_Voice_Start& s, uint8_t velocity) {
+  uint32_t start_count = latency.cycle_count();
+  if (queue_is_empty(&open_synth_channel_queue)) {
+    debug.trace(_trace_synth_no_voice);
+    return 0;
+  }
+  uint8_t ch;
+  queue_remove_blocking(&open_synth_channel_queue, &ch);
+  synth.voice[ch - 1].note_on(hexBoard.wavetable(s.wavetable), s.increment,
+    (s.loudness * velocity) >> 15, synth.envelope);
+  latency.record_cycles(_latency_note_on_cycles, start_count);
+  return ch;
+}
+// release the voice and return its channel to the queue
+void stop_synth_voice(uint8_t& ch) {
+  if (!ch) return;
+  synth.voice[ch - 1].note_off();
+  if (queue_is_full(&open_synth_channel_queue)) {
+    debug.trace(_trace_synth_queue_full);
+    return;
+  }
+  queue_add_blocking(&open_synth_channel_queue, &ch);
+  ch = 0;
+}
+
+// incoming MIDI plays the synth at the note's own pitch
+// (the tuning table's, in MTS mode) and lights the key 
+// nearest that pitch, so the board can follow along with
+// a sequencer. each note remembers the key it lit and
+// the voice it started, so its note-off undoes exactly
+// that even if the layout changed in between.
+struct External_Note {
+  uint8_t pixel = no_pixel;
+  uint8_t synth_ch = 0;
+};
+External_Note external_note[16][128];
+
+void on_external_note_off(byte channel, byte note, byte velocity) {
+  External_Note& e = external_note[(channel - 1) & 15][note & 127];
+  if ((e.pixel != no_pixel) && hexBoard.play_state[e.pixel].externalNotes) {
+    --hexBoard.play_state[e.pixel].externalNotes;
+  }
+  e.pixel = no_pixel;
+  stop_synth_voice(e.synth_ch);
+}
+void on_external_note_on(byte channel, byte note, byte velocity) {
+  // the synth and keys are off in the other states
+  if ((app_state != App_state::play_mode)
+   && (app_state != App_state::menu_nav)) return;
+  External_Note& e = external_note[(channel - 1) & 15][note & 127];
+  if ((e.pixel != no_pixel) || e.synth_ch) return; // already on
+  e.pixel = hexBoard.note_to_pixel[note];
+  if (e.pixel != no_pixel) {
+    ++hexBoard.play_state[e.pixel].externalNotes;
+  }
+  cents_fx pitch = (settings[_MIDImode].i == _MIDImode_tuning_table
+    ? mts.slot_pitch[note] : note * cents_fx_per_semitone);
+  e.synth_ch = start_synth_voice(synth_voice_start_at(settings, pitch), velocity);
+}
+
+// MIDI output for a key, in whichever MIDI mode is set.
+// MTS keys without a slot in the tuning table stay silent.
+void send_MIDI_note_on(Button b) {
+  if (!b.layout.isNote) return;
+  switch (settings[_MIDImode].i) {
+    case _MIDImode_MPE:
+      mpe.note_on(settings, b);
+      break;
+    case _MIDImode_tuning_table:
+      if (b.layout.midiTuningTable == MTS_unassigned) break;
+      // otherwise same as standard
+    default:
+      send_note_on(settings, b.layout.midiNote, b.play.velocity, b.layout.midiCh);
+      b.play.midiChPlaying   = b.layout.midiCh;
+      b.play.midiNotePlaying = b.layout.midiNote;
+      break;
+  }
+}
+void send_MIDI_note_off(Button b) {
+  if (settings[_MIDImode].i == _MIDImode_MPE) {
+    mpe.note_off(settings, b);
+    return;
+  }
+  if (!b.play.midiChPlaying) return;
+  send_note_off(settings, b.play.midiNotePlaying, 0, b.play.midiChPlaying);
+  b.play.midiChPlaying = 0;
+}
+void send_MIDI_pressure(Button b) {
+  if (settings[_MIDImode].i == _MIDImode_MPE) {
+    mpe.pressure(settings, b);
+    return;
+  }
+  if (!b.play.midiChPlaying) return;
+  uint8_t pressure = (b.play.pressure > 127 ? 127 : b.play.pressure);
+  send_poly_pressure(settings, b.play.midiNotePlaying, pressure, b.play.midiChPlaying);
+}
+
+void interpret_key_msg(Key_Msg& msg, uint32_t dequeue_time) {
+  Button b = hexBoard.button_at_linear_index(msg.switch_number);
+  b.play.update_levels(msg.timestamp, msg.level);
+  if (b.play.check_and_reset_just_pressed()) {
+    if (!b.layout.isBtn) {
+      hardwired_switch_handler(b.layout.pixel);
       return;
     }
 
-    debug.add("note ");
-    debug.add_num(b->midiPitch);
-    debug.add("tier ");
-    debug.add_num(b->paletteNum);
-    debug.add("A ");
-    debug.add_num(b->A_steps);
-    debug.add("B ");
-    debug.add_num(b->B_steps);
-    debug.add("octave ");
-    debug.add_num(b->scaleEquave);
-    debug.add("step ");
-    debug.add_num(b->scaleDegree);
-    debug.add(" / ");
-    debug.add_num(b->largeDegree);
-    debug.add("L,");
-    debug.add_num(b->smallDegree);
-    debug.add("s\n");
+    debug.trace(_trace_note_pitch, b.layout.midiNote, b.layout.paletteNum);
+    debug.trace(_trace_note_steps, b.layout.A_steps, b.layout.B_steps);
+    debug.trace(_trace_note_degree, b.layout.scaleEquave, b.layout.scaleDegree);
+    debug.trace(_trace_note_MOS, b.layout.largeDegree, b.layout.smallDegree);
 
     switch (app_state) {
       case App_state::play_mode:
       case App_state::menu_nav: {
-        settings[_anchorX].i = b->coord.x;
-        settings[_anchorY].i = b->coord.y;
-        if (queue_is_empty(&open_synth_channel_queue)) {
-          debug.add("emptyyyy\n");
-          return;
-        }
-        queue_remove_blocking(
-          &open_synth_channel_queue, 
-          &(b->synthChPlaying)
-        );
-        Synth_Voice *v = &synth.voice[(b->synthChPlaying) - 1];
-        double adj_f = frequency_after_pitch_bend(b->frequency, 0 /*pb*/, 2 /*pb range*/);
-        v->update_pitch(frequency_to_interval(adj_f, audio_sample_interval_uS));
-        if    ((settings[_synthWav].i == _synthWav_hybrid) || ( false /*mod > 0*/
-          &&  ((settings[_synthWav].i == _synthWav_square) 
-            || (settings[_synthWav].i == _synthWav_saw)
-            || (settings[_synthWav].i == _synthWav_triangle)
-        ))) {
-          v->update_wavetable(linear_waveform(adj_f, Linear_Wave::hybrid, 0 /*mod*/));
-        } else {
-          v->update_wavetable(hexBoard.cached_waveform);
+        if ((settings[_anchorX].i != b.layout.coord.x)
+         || (settings[_anchorY].i != b.layout.coord.y)) {
+          settings[_anchorX].i = b.layout.coord.x;
+          settings[_anchorY].i = b.layout.coord.y;
+          settings_saver.mark(settings, _anchorX);
+          settings_saver.mark(settings, _anchorY);
         }
-        v->update_base_volume((settings[_synthVol].i * b->velocity * iso226(adj_f)) >> 15);
-        switch (settings[_synthEnv].i) {
-          case _synthEnv_hit:
-            v->update_envelope(20/*ms*/, 50/*ms*/, 128/*0-255*/, 100/*ms*/);
-            break;
-          case _synthEnv_pluck:
-            v->update_envelope(20/*ms*/, 1000/*ms*/, 24/*0-255*/, 100/*ms*/);
-            break;
-          case _synthEnv_strum:
-            v->update_envelope(50/*ms*/, 2000/*ms*/, 128/*0-255*/, 500/*ms*/);
-            break;
-          case _synthEnv_slow:
-            v->update_envelope(1000/*ms*/, 0/*ms*/, 255/*0-255*/, 1000/*ms*/);
-            break;
-          case _synthEnv_reverse:
-            v->update_envelope(2000/*ms*/, 0/*ms*/, 0/*0-255*/, 0/*ms*/);
-            break;
-          default:
-            v->update_envelope(0, 0, 255, 0);
-            break;
+        send_MIDI_note_on(b);
+        b.play.synthChPlaying = start_synth_voice(b.layout.voice_start, b.play.velocity);
+        if (b.play.synthChPlaying) {
+          latency.record(_latency_dequeue_to_voice, dequeue_time);
         }
-        v->note_on();
         break;
       }
       default: break;
     }
-  } else if (b->check_and_reset_just_released()) {
+  } else if (b.play.check_and_reset_just_released()) {
     switch (app_state) {
       case App_state::play_mode:
       case App_state::menu_nav: {
-        if (!b->synthChPlaying) break;
-        Synth_Voice *v = &synth.voice[(b->synthChPlaying) - 1];
-        v->note_off();
-        if (queue_is_full(&open_synth_channel_queue)) {
-          debug.add("negative ghost rider the channels full\n");
-          return;
-        }
-        queue_add_blocking(
-          &open_synth_channel_queue, 
-          &(b->synthChPlaying)
-        );
-        b->synthChPlaying = 0;
+        send_MIDI_note_off(b);
+        stop_synth_voice(b.play.synthChPlaying);
         break;
       }
       default: break;
     }
-  } else if (b->pressure) {
-    //
+  } else if (b.play.pressure) {
+    send_MIDI_pressure(b);
+  }
+}
+
+uint32_t time_of_last_knob_action = 0;
+
+void enter_low_power_mode() {
+  app_state = App_state::low_power;
+  u8g2.setPowerSave(1);
+  strip.clear();
+  strip.show();
+}
+
+void exit_low_power_mode() {
+  u8g2.setPowerSave(0);
+  oled_screensaver.jiggle();
+  app_state = App_state::play_mode;
+}
+
+void process_low_power_knob(Rotary_Msg& M) {
+  if (M.action == Rotary_Action::long_press) {
+    exit_low_power_mode();
   }
 }
 
-void process_play_mode_knob(Rotary_Action& A) {
-  switch (A) {
+void process_play_mode_knob(Rotary_Msg& M) {
+  switch (M.action) {
     // TO-DO -- route other actions to various commands
     case Rotary_Action::long_press:
       menu.setMenuPageCurrent(pgHome);
@@ -315,7 +501,25 @@ void process_play_mode_knob(Rotary_Action& A) {
   }    
 }
 
-void process_menu_input(Rotary_Action& A) {
+void process_calibrate_knob(Rotary_Msg& M) {
+  switch (M.action) {
+    case Rotary_Action::click: {
+      size_t keysUpdated = keys.finish_calibration(true);
+      debug.trace(_trace_calibrated, keysUpdated);
+      save_key_calibration(keys, calibrationFileName);
+      app_state = App_state::play_mode;
+      break;
+    }
+    case Rotary_Action::long_press:
+      keys.finish_calibration(false);
+      app_state = App_state::play_mode;
+      break;
+    default:
+      break;
+  }
+}
+
+void process_menu_input(Rotary_Msg& M) {
   if (!menu.readyForKey()) return;
   screenupdate = 1;
 	bool editingFloat = menu.isEditMode();
@@ -323,14 +527,21 @@ void process_menu_input(Rotary_Action& A) {
     GEMItemPublic pubItem = *(menu.getCurrentMenuPage()->getCurrentMenuItem());
     editingFloat = (pubItem.getLinkedType() == GEM_VAL_DOUBLE);
   }
-  switch (A) {
+  // knob acceleration only applies when editing a select
+  // or spinner, and moves it all the steps with one redraw;
+  // moving between menu items is always one item per detent.
+  switch (M.action) {
     case Rotary_Action::turn_CW:
     case Rotary_Action::turn_CW_with_press:
-      menu.registerKeyPress(GEM_KEY_DOWN);
+      if ((M.steps <= 1) || !menu.step_edit_select(GEM_KEY_DOWN, M.steps)) {
+        menu.registerKeyPress(GEM_KEY_DOWN);
+      }
       break;
     case Rotary_Action::turn_CCW:
     case Rotary_Action::turn_CCW_with_press:
-      menu.registerKeyPress(GEM_KEY_UP);
+      if ((M.steps <= 1) || !menu.step_edit_select(GEM_KEY_UP, M.steps)) {
+        menu.registerKeyPress(GEM_KEY_UP);
+      }
       break;
     case Rotary_Action::click:
       if (editingFloat) {
@@ -371,9 +582,11 @@ void process_menu_input(Rotary_Action& A) {
 
 struct repeating_timer polling_timer_LED;
 bool on_LED_frame_refresh(repeating_timer *t) {
-  for (auto& b : hexBoard.btn) {
-    if (!b.isBtn) continue;
-    strip.setPixelColor(b.pixel, b.LEDcodeBase);
+  if (app_state == App_state::low_power) return true;
+  for (size_t p = 0; p < ledCount; ++p) {
+    strip.setPixelColor(p, (hexBoard.play_state[p].externalNotes
+      ? hexBoard.LED_codes[p].LEDcodePlay 
+      : hexBoard.LED_codes[p].LEDcodeRest));
   }
   strip.show();
   return true;
@@ -389,10 +602,21 @@ bool on_OLED_frame_refresh(repeating_timer *t) {
       oled_screensaver.jiggle();
       break;
     case App_state::play_mode:
+      if (!keys.is_idle()) oled_screensaver.jiggle();
+      oled_screensaver.poll();
       u8g2.clearBuffer();
       GUI.draw();
       u8g2.sendBuffer();
       break;
+    case App_state::calibrate:
+      u8g2.clearBuffer();
+      u8g2.drawStr(_LEFT_MARGIN, 12, "Key calibration");
+      u8g2.drawStr(_LEFT_MARGIN, 36, "Press every key");
+      u8g2.drawStr(_LEFT_MARGIN, 48, "all the way down.");
+      u8g2.drawStr(_LEFT_MARGIN, 72, "Click: save");
+      u8g2.drawStr(_LEFT_MARGIN, 84, "Hold:  cancel");
+      u8g2.sendBuffer();
+      break;
     default:
       break;
   }
@@ -401,26 +625,43 @@ bool on_OLED_frame_refresh(repeating_timer *t) {
 
 struct repeating_timer polling_timer_debug;
 bool on_debug_refresh(repeating_timer *t) {
-  //debug.add_num(successes);
-  //debug.add("\n");
+  // send "L" over the serial monitor for a latency report, "C" to clear it,
+  // "M" for MIDI output counts, "S" for settings file writes,
+  // "E" for core1 timing (audio jitter, slot times, overruns)
+  while (Serial.available()) {
+    switch (Serial.read()) {
+      case 'L': latency.dump();           break;
+      case 'C': latency.clear();
+                executive.request_clear(); break;
+      case 'M': dump_MIDI_output_stats(); break;
+      case 'S': settings_saver.dump();    break;
+      case 'E': executive.dump();         break;
+      default:                            break;
+    }
+  }
   debug.send();
   return true;
 }
 
 void setup() {
   queue_init(&key_press_queue, sizeof(Key_Msg), keys_count + 1);
-  queue_init(&rotary_action_queue,  sizeof(Rotary_Action),  32);
+  queue_init(&rotary_action_queue,  sizeof(Rotary_Msg),     32);
   load_factory_defaults_to(settings);
   link_settings_to_objects(settings);
+  latency.begin_cycle_count(); // for timing note-on on this core
 
   mount_tinyUSB();
   connect_OLED_display(OLED_sdaPin, OLED_sclPin);
   connect_neoPixels(ledPin, ledCount);
   mount_file_system();  
-  //if (!load_settings(settings, settingFileName)) { // attempt to load saved settings, and if not,  
-  //}  
+  load_key_calibration(keys, calibrationFileName);
+  load_settings(settings, settingFileName); // if this fails the defaults stay
+  init_MIDI(); // before the layout, which may send a tuning table
+  UMIDI.setHandleNoteOn(on_external_note_on);
+  UMIDI.setHandleNoteOff(on_external_note_off);
+  SMIDI.setHandleNoteOn(on_external_note_on);
+  SMIDI.setHandleNoteOff(on_external_note_off);
   apply_settings_to_objects(settings);
-  init_MIDI();
   initialize_synth_channel_queue();
   menu_setup();
   add_repeating_timer_ms(
@@ -443,18 +684,38 @@ void setup() {
 }
 
 Key_Msg key_msg_out;
-Rotary_Action rotary_action_out;
+Rotary_Msg    rotary_action_out;
 
 void loop() {
   if (queue_try_remove(&key_press_queue, &key_msg_out)) {
-    interpret_key_msg(key_msg_out);
-    // if you are in calibration mode, that routine can send msgs to calibration_queue
+    uint32_t dequeue_time = timer_hw->timerawl;
+    latency.record(_latency_scan_to_dequeue, key_msg_out.timestamp);
+    interpret_key_msg(key_msg_out, dequeue_time);
+    // the key press that wakes the board is not played
+    if ((app_state == App_state::low_power) && key_msg_out.level) {
+      exit_low_power_mode();
+    }
   }
   if (queue_try_remove(&rotary_action_queue, &rotary_action_out)) {
+    time_of_last_knob_action = timer_hw->timerawl;
     switch (app_state) {
       case App_state::play_mode:  process_play_mode_knob(rotary_action_out); break;
       case App_state::menu_nav: 	process_menu_input(rotary_action_out);     break;
+      case App_state::calibrate:  process_calibrate_knob(rotary_action_out); break;
+      case App_state::low_power:  process_low_power_knob(rotary_action_out); break;
       default:                                                               break;
     }
   }
+  UMIDI.read();
+  SMIDI.read();
+  drain_MIDI_output();
+  // a flash write stalls both cores, so only save
+  // while nothing is sounding or being played
+  settings_saver.poll(settings, settingFileName, synth.is_silent()
+    && (keys.time_since_last_change() >= settings_save_delay_uS));
+  if ((app_state == App_state::play_mode)
+   && (keys.time_since_last_change() >= low_power_timeout_uS)
+   && (timer_hw->timerawl - time_of_last_knob_action >= low_power_timeout_uS)) {
+    enter_low_power_mode();
+  }
 }
\ No newline at end of file
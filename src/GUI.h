@@ -33,18 +33,20 @@ struct GUI_Object {
 		}
 		
 		if (context & _show_HUD) {
-			for (auto& b : hexBoard.btn) {
+			for (size_t p = 0; p < ledCount; ++p) {
+				const Button_Layout_Data& b = hexBoard.layout_data[p];
+				uint8_t pressure = hexBoard.play_state[p].pressure;
 				if (!b.isBtn) continue;
 				int atX = hex_0_0_at_X + 2 * b.coord.x 
 																	- (b.coord.x <= -10 ? 1 : 0);
 				int atY = hex_0_0_at_Y + 3 * b.coord.y;
 				u8g2.drawPixel(atX,atY);
-				if (b.pressure) {
+				if (pressure) {
 																u8g2.drawPixel(atX  ,atY-1);   // off low mid hi
 																u8g2.drawPixel(atX  ,atY+1);   //      *   *  ***
-				if (b.pressure >  64) { u8g2.drawPixel(atX-1,atY  );   //  *   *  *** ***
+				if (pressure >  64) { u8g2.drawPixel(atX-1,atY  );   //  *   *  *** ***
 																u8g2.drawPixel(atX+1,atY  ); } //      *   *  ***
-				if (b.pressure >  96) { u8g2.drawPixel(atX-1,atY-1);   //
+				if (pressure >  96) { u8g2.drawPixel(atX-1,atY-1);   //
 																u8g2.drawPixel(atX-1,atY+1);   //
 																u8g2.drawPixel(atX+1,atY-1);   //
 																u8g2.drawPixel(atX+1,atY+1); } //          
@@ -63,7 +65,7 @@ struct GUI_Object {
 			if (hexBoard.in_bounds(selHex)) {
 				u8g2.drawStr(_LEFT_MARGIN, 8, "Anchor hex: ");
 				u8g2.drawStr(_LEFT_MARGIN + 84, 8, 
-				  std::to_string(hexBoard.coord_to_pixel[selHex]).c_str());
+				  std::to_string(hexBoard.button_at_coord(selHex).layout.pixel).c_str());
 			} else {
 				u8g2.drawStr(_LEFT_MARGIN, 8, "Press anchor hex >>");
 			}
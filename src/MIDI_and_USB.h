@@ -2,24 +2,211 @@
 #include <Adafruit_TinyUSB.h>   // library of code to get the USB port working
 #include <MIDI.h>               // library of code to send and receive MIDI messages
 #include "pico/time.h"
+#include "config.h"
 #include "debug.h"
+#include "settings.h"
+
+// the port will take this byte right now without waiting
+bool write_MIDI_byte_if_room(HardwareSerial& port, byte b) {
+  if (port.availableForWrite() < 1) return false;
+  port.write(b);
+  return true;
+}
+
+// MIDI library transport that writes into a ring instead of
+// straight to the port, so a chord's worth of messages returns
+// at once and loop() trickles the bytes out as the port has
+// room (see drain_MIDI_output). only if the ring is full does
+// a write wait for the DIN port, which always empties at the
+// baud rate. USB never waits on the host: a byte that finds
+// the ring full and the host not reading is dropped and counted.
+// incoming bytes are read directly.
+// the ring holds the largest burst the firmware sends, a full
+// set of MTS single-note changes (4 x 136 bytes, a bulk dump is
+// 408), with room left for notes, so a retune is not an overflow.
+const size_t MIDI_ring_size = 1024;
+// a full-speed USB bulk transfer is 64 bytes = 16 event packets,
+// which is 16 three-byte channel messages
+const size_t USB_MIDI_frame_bytes = 48;
+
+template <class Port>
+class MIDI_Ring_Transport {
+public:
+  MIDI_Ring_Transport(Port& port) : _port(port) {}
+  static const bool thruActivated = true;
+
+  void begin() {
+    _port.begin(31250);
+  }
+  bool beginTransmission(midi::MidiType) {
+    return true;
+  }
+  void write(byte b) {
+    if (_count == MIDI_ring_size) {
+      ++overflows;
+      drain(true);
+      if (_count == MIDI_ring_size) {
+        ++dropped; // the port took nothing
+        return;
+      }
+    }
+    if (_count == 0) {
+      _oldest = timer_hw->timerawl;
+    }
+    _ring[_head] = b;
+    _head = (_head + 1) % MIDI_ring_size;
+    ++_count;
+  }
+  void endTransmission() {}
+  byte read() {
+    return _port.read();
+  }
+  unsigned available() {
+    return _port.available();
+  }
+
+  // force = the ring is full, wait until the port takes
+  // at least one byte (at most one byte's time on the wire)
+  void drain(bool force = false) {
+    if (force) {
+      while (_port.availableForWrite() < 1) {}
+    }
+    while (_count && write_MIDI_byte_if_room(_port, _ring[_tail])) {
+      _tail = (_tail + 1) % MIDI_ring_size;
+      --_count;
+    }
+  }
+
+  uint32_t overflows = 0; // writes that found the ring full
+  uint32_t dropped   = 0; // USB only: bytes thrown away with no host reading them
+  uint32_t transfers = 0; // USB only: batches handed to TinyUSB
+  uint32_t sent      = 0; // USB only: bytes in those batches
+
+private:
+  Port&    _port;
+  byte     _ring[MIDI_ring_size];
+  size_t   _head = 0;
+  size_t   _tail = 0;
+  size_t   _count = 0;
+  uint32_t _oldest = 0; // when the oldest byte in the ring was written
+};
+
+// USB is drained a frame at a time instead: bytes wait until
+// there is a full transfer's worth, or the oldest has waited
+// one USB frame, and then go to TinyUSB in a single call so
+// that a chord leaves in one bulk transfer, not one per note.
+template <>
+void MIDI_Ring_Transport<Adafruit_USBD_MIDI>::drain(bool force) {
+  if (force && !tud_midi_mounted()) {
+    dropped += _count;
+    _tail = _head;
+    _count = 0;
+    return;
+  }
+  while (_count) {
+    if (!force
+     && (_count < USB_MIDI_frame_bytes)
+     && (timer_hw->timerawl - _oldest < USB_MIDI_max_hold_uS)) {
+      return;
+    }
+    byte frame[USB_MIDI_frame_bytes];
+    size_t n = (_count < USB_MIDI_frame_bytes ? _count : USB_MIDI_frame_bytes);
+    for (size_t i = 0; i < n; ++i) {
+      frame[i] = _ring[(_tail + i) % MIDI_ring_size];
+    }
+    uint32_t accepted = tud_midi_stream_write(0, frame, n);
+    // the host has not collected the last one yet. if forced,
+    // write() drops the new byte rather than wait on the host
+    if (!accepted) return;
+    _tail = (_tail + accepted) % MIDI_ring_size;
+    _count -= accepted;
+    ++transfers;
+    sent += accepted;
+  }
+}
+
+// the DIN port drops the status byte when it repeats
+// (running status), a third less wire time for a chord.
+struct Serial_MIDI_Settings : public midi::DefaultSettings {
+  static const bool UseRunningStatus = true;
+};
 
 Adafruit_USBD_MIDI usb_midi_over_Serial0;
-MIDI_CREATE_INSTANCE(Adafruit_USBD_MIDI, usb_midi_over_Serial0, UMIDI);
-MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, SMIDI);
+MIDI_Ring_Transport<Adafruit_USBD_MIDI> usb_MIDI_transport(usb_midi_over_Serial0);
+MIDI_Ring_Transport<HardwareSerial>     serial_MIDI_transport(Serial1);
+midi::MidiInterface<MIDI_Ring_Transport<Adafruit_USBD_MIDI>> UMIDI(usb_MIDI_transport);
+midi::MidiInterface<MIDI_Ring_Transport<HardwareSerial>, Serial_MIDI_Settings> SMIDI(serial_MIDI_transport);
+
+void drain_MIDI_output() {
+  usb_MIDI_transport.drain();
+  serial_MIDI_transport.drain();
+}
+
+void dump_MIDI_output_stats() {
+  Serial.print("USB MIDI: transfers=");
+  Serial.print(usb_MIDI_transport.transfers);
+  Serial.print(" bytes=");
+  Serial.print(usb_MIDI_transport.sent);
+  Serial.print(" ring full=");
+  Serial.print(usb_MIDI_transport.overflows);
+  Serial.print(" dropped=");
+  Serial.println(usb_MIDI_transport.dropped);
+  Serial.print("DIN MIDI: ring full=");
+  Serial.println(serial_MIDI_transport.overflows);
+}
 
 void mount_tinyUSB() {
   uint64_t mountTime = timer_hw->timerawl;
   while (!TinyUSBDevice.mounted()) {}
   mountTime = timer_hw->timerawl - mountTime;
   Serial.begin(115200);
-  debug.add("it took ");
-  debug.add_num(mountTime);
-  debug.add("uS to mount TinyUSB.\n");
+  debug.trace(_trace_USB_mounted, mountTime);
 }
 
 void init_MIDI() {
   usb_midi_over_Serial0.setStringDescriptor("HexBoard MIDI");  // Initialize MIDI, and listen to all MIDI channels
   UMIDI.begin(MIDI_CHANNEL_OMNI);                 // This will also call usb_midi's begin()
   SMIDI.begin(MIDI_CHANNEL_OMNI);
+  UMIDI.turnThruOff();  // input is played here, not echoed back out
+  SMIDI.turnThruOff();
+}
+
+// send to whichever ports are switched on in the menu.
+void send_note_on(hexBoard_Setting_Array& refS, uint8_t note, uint8_t velocity, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendNoteOn(note, velocity, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendNoteOn(note, velocity, ch);
+}
+void send_note_off(hexBoard_Setting_Array& refS, uint8_t note, uint8_t velocity, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendNoteOff(note, velocity, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendNoteOff(note, velocity, ch);
+}
+void send_pitch_bend(hexBoard_Setting_Array& refS, int16_t bend, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendPitchBend(bend, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendPitchBend(bend, ch);
+}
+void send_poly_pressure(hexBoard_Setting_Array& refS, uint8_t note, uint8_t pressure, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendAfterTouch(note, pressure, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendAfterTouch(note, pressure, ch);
+}
+void send_channel_pressure(hexBoard_Setting_Array& refS, uint8_t pressure, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendAfterTouch(pressure, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendAfterTouch(pressure, ch);
+}
+void send_control_change(hexBoard_Setting_Array& refS, uint8_t control, uint8_t value, uint8_t ch) {
+  if (refS[_MIDIusb].b)  UMIDI.sendControlChange(control, value, ch);
+  if (refS[_MIDIjack].b) SMIDI.sendControlChange(control, value, ch);
+}
+// registered parameter number, coarse value then fine
+void send_RPN(hexBoard_Setting_Array& refS, uint8_t msb, uint8_t lsb, 
+              uint8_t coarse, uint8_t fine, uint8_t ch) {
+  send_control_change(refS, 101, msb,    ch);
+  send_control_change(refS, 100, lsb,    ch);
+  send_control_change(refS,   6, coarse, ch);
+  send_control_change(refS,  38, fine,   ch);
+}
+// the array must include the F0 ... F7 boundaries.
+void send_sysex_to_enabled_ports(hexBoard_Setting_Array& refS, 
+                                 size_t length, const byte* data) {
+  if (refS[_MIDIusb].b)  UMIDI.sendSysEx(length, data, true);
+  if (refS[_MIDIjack].b) SMIDI.sendSysEx(length, data, true);
 }
\ No newline at end of file
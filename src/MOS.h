@@ -0,0 +1,141 @@
+#pragma once
+/*
+ *  Moment of symmetry (MOS) scales for the layout
+ *  generator. Kept apart from layout.h, which needs
+ *  the whole sketch, so that the host tests in test/
+ *  can check it against the old recursive generator.
+ */
+#include <Arduino.h>
+
+// MOS scale stored as a bit-packed word of steps:
+// large step = 1, small step = 0.
+// Lg and Sm are each at most 255, so the word fits in 512 bits.
+// nothing here allocates; a MOS_Scale lives on the stack
+// for the duration of the layout routine.
+const size_t MOS_capacity = 512;
+const size_t MOS_words    = MOS_capacity / 32;
+
+uint gcd(uint _a, uint _b) {
+  while (_b) {
+    uint _r = _a % _b;
+    _a = _b;
+    _b = _r;
+  }
+  return _a;
+}
+
+struct MOS_Scale {
+  uint32_t steps[MOS_words];
+  uint Lg;
+  uint Sm;
+  uint K; // GCD
+  uint G; // bright generator
+  uint modeCt;
+  bool rational;
+  uint underlyingEDO;
+
+  float ratio_f;
+  uint ratio_num_s;
+  uint ratio_den_L;
+
+  void determine_G_and_K() {
+    K = gcd(Lg,Sm);
+    G = 0;
+    for (uint m = 1; m < (Lg + Sm); ++m) {
+      if ((Sm * m) % (Lg + Sm) == 1) {
+        G = m;
+        break;
+      }
+    }
+    modeCt = (Lg + Sm) / K;
+  }
+
+  // the brightest mode is the upper Christoffel word of the
+  // primitive (L/K, S/K) scale, repeated K times: step i is
+  // large if ceil((i+1)L/n) > ceil(iL/n). built in one pass
+  // by carrying the running numerator instead of recursing.
+  void generate_steps() {
+    for (auto& w : steps) { w = 0; }
+    uint L = Lg / K;
+    uint n = (Lg + Sm) / K;
+    uint acc = 0; // (i mod n) * L
+    for (uint i = 0; i < (Lg + Sm); ++i) {
+      uint before = (acc + n - 1) / n;
+      acc += L;
+      uint after  = (acc + n - 1) / n;
+      if (after > before) {
+        steps[i >> 5] |= (1u << (i & 31));
+      }
+      if (acc == n * L) { acc = 0; }
+    }
+  }
+
+  MOS_Scale(int argL, int argS) : Lg(argL), Sm(argS) {
+    determine_G_and_K();
+    generate_steps();
+  }
+
+  void set_L_S_ratio(float r) {
+    rational = false;
+    ratio_f = r;
+    underlyingEDO = 0;
+  }
+
+  void set_L_S_ratio(uint n_s, uint d_l) {
+    rational = true;
+    ratio_num_s = n_s;
+    ratio_den_L = d_l;
+    ratio_f = (float)n_s / (float)d_l;
+    underlyingEDO = Sm * d_l + Lg * n_s;
+  }
+
+  // number of large steps among the first j steps of the word
+  uint large_steps_before(uint j) const {
+    uint result = 0;
+    for (uint w = 0; w < (j >> 5); ++w) {
+      result += __builtin_popcount(steps[w]);
+    }
+    if (j & 31) {
+      result += __builtin_popcount(steps[j >> 5] & ((1u << (j & 31)) - 1));
+    }
+    return result;
+  }
+
+  // number of large steps among the first `count` steps of a mode
+  uint large_steps_in_mode(uint mode, uint count) const {
+    uint n = Lg + Sm;
+    uint start = (G * mode) % n;
+    uint end = start + count;
+    if (end <= n) {
+      return large_steps_before(end) - large_steps_before(start);
+    }
+    return Lg - large_steps_before(start) + large_steps_before(end - n);
+  }
+
+  // is there a note in this mode that is lg large and sm small steps up
+  bool in_mode(uint mode, uint lg, uint sm) const {
+    if (lg + sm >= Lg + Sm) return false;
+    return (large_steps_in_mode(mode % modeCt, lg + sm) == lg);
+  }
+
+  // rational ratios only: is there a note in this mode
+  // at this step of the underlying EDO. the EDO step rises
+  // with each note of the mode, so binary search for it.
+  bool in_mode_EDO_equiv(uint mode, uint degree) const {
+    mode %= modeCt;
+    uint lo = 0;
+    uint hi = Lg + Sm;
+    while (lo < hi) {
+      uint mid = (lo + hi) / 2;
+      uint lg = large_steps_in_mode(mode, mid);
+      if (lg * ratio_num_s + (mid - lg) * ratio_den_L < degree) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo >= Lg + Sm) return false;
+    uint lg = large_steps_in_mode(mode, lo);
+    return (lg * ratio_num_s + (lo - lg) * ratio_den_L == degree);
+  }
+};
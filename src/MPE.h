@@ -0,0 +1,161 @@
+#pragma once
+/*
+ *  MIDI Polyphonic Expression (MPE) output.
+ *  Each note is sent on its own member channel
+ *  so that it can carry its own pitch bend and
+ *  pressure. Member channels are handed out
+ *  least-recently-used, so a released note's
+ *  tail is overwritten last.
+ *
+ *  The bend for each key is worked out once at
+ *  layout time (Button_Layout_Data::midiBend),
+ *  and the last bend and pressure sent on each
+ *  channel is cached so repeats are not resent.
+ */
+#include <stdint.h>
+#include "config.h"
+#include "settings.h"
+#include "hexBoard.h"
+#include "MIDI_and_USB.h"
+
+// _MPEzoneC menu options
+enum {
+  _MPEzone_lower = 0, // master ch 1, members from ch 2 up
+  _MPEzone_upper = 1, // master ch 16, members from ch 15 down
+  _MPEzone_split = 2  // both, left side of the board plays the lower zone
+};
+const int16_t MPE_bend_unknown     = INT16_MIN;
+const uint8_t MPE_pressure_unknown = UINT8_MAX;
+
+struct MPE_Zone {
+  uint8_t master = 0;  // 0 = zone not in use
+  uint8_t first  = 0;  // lowest member channel
+  uint8_t last   = 0;  // highest member channel
+};
+
+struct MPE_Channel_State {
+  uint8_t  notes    = 0;  // notes currently on
+  uint8_t  note     = 0;  // the last note number started here
+  int16_t  owner    = -1; // the pixel of the key that started it
+  uint32_t stamp    = 0;  // when this channel's note last started or ended
+  int16_t  bend     = MPE_bend_unknown;
+  uint8_t  pressure = MPE_pressure_unknown;
+};
+
+struct hexBoard_MPE_Object {
+  MPE_Zone          lower;
+  MPE_Zone          upper;
+  MPE_Channel_State channel[17]; // 1-indexed like MIDI channels
+  uint32_t          clock = 0;
+
+  // read the zone settings and announce them to the receiver
+  // with the MPE configuration message, then set the pitch
+  // bend range on every member channel.
+  void configure(hexBoard_Setting_Array& refS) {
+    lower = MPE_Zone();
+    upper = MPE_Zone();
+    int zones = refS[_MPEzoneC].i;
+    if (zones != _MPEzone_upper) {
+      lower.master = 1;
+      lower.first  = 2;
+      lower.last   = refS[_MPEzoneL].i;
+    }
+    if (zones != _MPEzone_lower) {
+      upper.master = 16;
+      upper.first  = refS[_MPEzoneR].i;
+      upper.last   = 15;
+      if (lower.master && (upper.first <= lower.last)) {
+        upper.first = lower.last + 1;
+      }
+    }
+    // a note still held would never get its note-off once
+    // the channel state is reset, so end it now
+    for (uint8_t ch = 1; ch <= 16; ++ch) {
+      if (channel[ch].notes) {
+        send_note_off(refS, channel[ch].note, 0, ch);
+      }
+    }
+    for (auto& c : channel) { c = MPE_Channel_State(); }
+    for (MPE_Zone* z : {&lower, &upper}) {
+      if (!z->master) continue;
+      uint8_t members = (z->last >= z->first ? z->last - z->first + 1 : 0);
+      send_RPN(refS, 0, 6, members, 0, z->master);     // MPE configuration message
+      for (uint8_t ch = z->first; ch <= z->last; ++ch) {
+        send_RPN(refS, 0, 0, refS[_MPEpb].i, 0, ch);   // pitch bend sensitivity
+      }
+    }
+  }
+
+  const MPE_Zone& zone_for(const Button_Layout_Data& n) {
+    if (!upper.master) return lower;
+    if (!lower.master) return upper;
+    return (2 * n.coord.x <= grid_min_x + grid_max_x ? lower : upper);
+  }
+
+  // the idle channel whose note ended longest ago, or if
+  // none are idle, the channel whose note started longest ago
+  uint8_t allocate(const MPE_Zone& z) {
+    uint8_t best = 0;
+    for (uint8_t ch = z.first; ch <= z.last; ++ch) {
+      if (!best) { best = ch; continue; }
+      bool idle     = (channel[ch].notes   == 0);
+      bool bestIdle = (channel[best].notes == 0);
+      if (idle != bestIdle) {
+        if (idle) { best = ch; }
+      } else if (channel[ch].stamp < channel[best].stamp) {
+        best = ch;
+      }
+    }
+    return best;
+  }
+
+  void note_on(hexBoard_Setting_Array& refS, Button b) {
+    const MPE_Zone& z = zone_for(b.layout);
+    uint8_t ch = allocate(z);
+    if (!ch) return;
+    MPE_Channel_State& c = channel[ch];
+    if (c.notes) {
+      // stealing: end the old note first
+      send_note_off(refS, channel[ch].note, 0, ch);
+      c.notes = 0;
+    }
+    if (c.bend != b.layout.midiBend) {
+      send_pitch_bend(refS, b.layout.midiBend, ch);
+      c.bend = b.layout.midiBend;
+    }
+    send_note_on(refS, b.layout.midiNote, b.play.velocity, ch);
+    c.notes = 1;
+    c.stamp = ++clock;
+    c.note = b.layout.midiNote;
+    c.owner = b.layout.pixel;
+    b.play.midiChPlaying = ch;
+    b.play.midiNotePlaying = b.layout.midiNote;
+  }
+
+  // the channel may have been stolen by a newer note,
+  // which can have the same note number with another bend,
+  // so check which key it belongs to now
+  bool owns(const Button& b, uint8_t ch) {
+    return (ch && channel[ch].notes && (channel[ch].owner == b.layout.pixel));
+  }
+
+  void note_off(hexBoard_Setting_Array& refS, Button b) {
+    uint8_t ch = b.play.midiChPlaying;
+    if (!ch) return;
+    b.play.midiChPlaying = 0;
+    if (!owns(b, ch)) return;
+    send_note_off(refS, b.play.midiNotePlaying, 0, ch);
+    channel[ch].notes = 0;
+    channel[ch].owner = -1;
+    channel[ch].stamp = ++clock;
+  }
+
+  void pressure(hexBoard_Setting_Array& refS, Button b) {
+    uint8_t ch = b.play.midiChPlaying;
+    if (!owns(b, ch)) return;
+    uint8_t p = (b.play.pressure > 127 ? 127 : b.play.pressure);
+    if (channel[ch].pressure == p) return;
+    send_channel_pressure(refS, p, ch);
+    channel[ch].pressure = p;
+  }
+};
@@ -0,0 +1,171 @@
+#pragma once
+/*
+ *  MIDI Tuning Standard (MTS) output.
+ *  In this MIDI mode every distinct pitch on the
+ *  layout gets its own MIDI note number, and the
+ *  receiving synth is told what pitch each note
+ *  number should play. Any layout then plays on
+ *  one channel with no pitch bend.
+ *
+ *  A bulk tuning dump goes out whenever the key
+ *  to note assignment changes. If only pitches
+ *  moved (e.g. transpose) the changed notes are
+ *  sent as real-time single note tuning changes.
+ */
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include "config.h"
+#include "settings.h"
+#include "hexBoard.h"
+#include "MIDI_and_USB.h"
+
+const uint8_t MTS_slot_count   = 128;
+const uint8_t MTS_unassigned   = 255;
+const cents_fx MTS_same_pitch  = cents_fx_per_semitone / 1000; // 0.1 cents
+const uint8_t MTS_device_ID    = 0x7F;   // all devices
+const uint8_t MTS_program      = 0;      // tuning program to write
+const uint8_t MTS_retune_batch = 32;     // notes per single note message
+// a whole retune must fit in the MIDI output ring without waiting
+static_assert(6 + 16 + 3 * MTS_slot_count + 2 < MIDI_ring_size, "MTS dump overflows the MIDI ring");
+static_assert((MTS_slot_count / MTS_retune_batch) * (8 + 4 * MTS_retune_batch) < MIDI_ring_size, "MTS retune overflows the MIDI ring");
+
+// MTS frequency word: semitone, then the fraction
+// above it in units of 100/16384 cents, 7 bits per byte.
+// 7F 7F 7F means "no change" so it is never produced.
+// (100 << 16) / 16384 = 400 cents_fx per unit.
+void write_MTS_frequency(byte* out, cents_fx pitch) {
+  int32_t units = (pitch + 200) / 400;
+  if (units < 0) units = 0;
+  if (units > 0x1FFFFE) units = 0x1FFFFE;
+  out[0] = (units >> 14) & 0x7F;
+  out[1] = (units >>  7) & 0x7F;
+  out[2] =  units        & 0x7F;
+}
+
+struct hexBoard_MTS_Object {
+  cents_fx slot_pitch[MTS_slot_count]; // as last sent
+  cents_fx new_pitch[MTS_slot_count];  // scratch space, kept off the stack
+  cents_fx unique[ledCount];           // sorted pitches on the layout
+  bool    current = false; // has the receiver got this table?
+
+  // assign each note button a slot and retune the receiver.
+  // unique pitches are sorted and placed so that the anchor
+  // key keeps its MIDI note number if the range allows.
+  void update(hexBoard_Setting_Array& refS, hexBoard_Grid_Object& grid, 
+              cents_fx anchorPitch, uint8_t anchorNote) {
+    size_t count = 0;
+    for (auto& n : grid.layout_data) {
+      if (!(n.isBtn && n.isNote)) continue;
+      unique[count] = n.pitch;
+      ++count;
+    }
+    std::sort(unique, unique + count);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if ((kept == 0) || (unique[i] - unique[kept - 1] >= MTS_same_pitch)) {
+        unique[kept] = unique[i];
+        ++kept;
+      }
+    }
+    count = kept;
+    if (count == 0) return;
+
+    size_t anchorIndex = 0;
+    for (size_t i = 1; i < count; ++i) {
+      if (std::abs(unique[i] - anchorPitch) < std::abs(unique[anchorIndex] - anchorPitch)) {
+        anchorIndex = i;
+      }
+    }
+    // slot = index + offset, kept inside 0..127
+    int offset = (int)anchorNote - (int)anchorIndex;
+    int lowest  = std::min(0, (int)MTS_slot_count - (int)count);
+    int highest = std::max(0, (int)MTS_slot_count - (int)count);
+    offset = std::max(lowest, std::min(highest, offset));
+
+    for (uint8_t s = 0; s < MTS_slot_count; ++s) {
+      new_pitch[s] = s * cents_fx_per_semitone; // unused slots stay at standard tuning
+    }
+    for (size_t i = 0; i < count; ++i) {
+      int s = (int)i + offset;
+      if ((s >= 0) && (s < MTS_slot_count)) { new_pitch[s] = unique[i]; }
+    }
+
+    bool reassigned = !current;
+    for (auto& n : grid.layout_data) {
+      if (!(n.isBtn && n.isNote)) continue;
+      size_t i = std::lower_bound(unique, unique + count, 
+                                  n.pitch - MTS_same_pitch) - unique;
+      int s = (int)i + offset;
+      uint8_t slot = ((s >= 0) && (s < MTS_slot_count) ? s : MTS_unassigned);
+      if (slot != n.midiTuningTable) { reassigned = true; }
+      n.midiTuningTable = slot;
+      if (slot != MTS_unassigned) { n.midiNote = slot; }
+    }
+
+    if (reassigned) {
+      std::copy(new_pitch, new_pitch + MTS_slot_count, slot_pitch);
+      send_bulk_dump(refS);
+    } else {
+      send_changes(refS);
+    }
+    current = true;
+  }
+
+  // non-real-time bulk tuning dump, all 128 notes
+  void send_bulk_dump(hexBoard_Setting_Array& refS) {
+    byte msg[6 + 16 + 3 * MTS_slot_count + 2];
+    const char name[16] = {'H','e','x','B','o','a','r','d',' ',' ',' ',' ',' ',' ',' ',' '};
+    size_t at = 0;
+    msg[at++] = 0xF0;
+    msg[at++] = 0x7E;
+    msg[at++] = MTS_device_ID;
+    msg[at++] = 0x08;
+    msg[at++] = 0x01;
+    msg[at++] = MTS_program;
+    for (auto c : name) { msg[at++] = c; }
+    for (uint8_t s = 0; s < MTS_slot_count; ++s) {
+      write_MTS_frequency(&msg[at], slot_pitch[s]);
+      at += 3;
+    }
+    byte checksum = 0;
+    for (size_t i = 1; i < at; ++i) { checksum ^= msg[i]; }
+    msg[at++] = checksum & 0x7F;
+    msg[at++] = 0xF7;
+    send_sysex_to_enabled_ports(refS, at, msg);
+  }
+
+  // real-time single note tuning change for each slot
+  // whose pitch moved, batched into a few messages
+  void send_changes(hexBoard_Setting_Array& refS) {
+    byte msg[7 + 4 * MTS_retune_batch + 1];
+    uint8_t batch = 0;
+    for (uint8_t s = 0; s <= MTS_slot_count; ++s) {
+      bool last = (s == MTS_slot_count);
+      if (!last && (std::abs(new_pitch[s] - slot_pitch[s]) >= MTS_same_pitch)) {
+        slot_pitch[s] = new_pitch[s];
+        byte* entry = &msg[7 + 4 * batch];
+        entry[0] = s;
+        write_MTS_frequency(&entry[1], slot_pitch[s]);
+        ++batch;
+      }
+      if ((batch == MTS_retune_batch) || (last && batch)) {
+        msg[0] = 0xF0;
+        msg[1] = 0x7F;
+        msg[2] = MTS_device_ID;
+        msg[3] = 0x08;
+        msg[4] = 0x02;
+        msg[5] = MTS_program;
+        msg[6] = batch;
+        msg[7 + 4 * batch] = 0xF7;
+        send_sysex_to_enabled_ports(refS, 8 + 4 * batch, msg);
+        batch = 0;
+      }
+    }
+  }
+
+  // next update() sends a full dump
+  void invalidate() {
+    current = false;
+  }
+};
@@ -57,7 +57,7 @@ const size_t col_pins_count = sizeof(colPins)/sizeof(colPins[0]);  // should equ
 constexpr size_t mux_channels_count = 1 << mux_pins_count;         // should equal 16
 constexpr size_t keys_count = mux_channels_count * col_pins_count; // should equal 160
 
-size_t linear_index(uint8_t argM, uint8_t argC) {  // should return value 0 thru 159
+constexpr size_t linear_index(uint8_t argM, uint8_t argC) {  // should return value 0 thru 159
   return (argC << mux_pins_count) + argM;
 }
 
@@ -75,7 +75,18 @@ const uint32_t highest_MIDI_note_Hz = 13290;
 const uint32_t target_sample_rate_Hz = 2 * highest_MIDI_note_Hz;
 constexpr int32_t audio_sample_interval_uS = 31250 / (target_sample_rate_Hz >> 5);
 const int32_t key_poll_interval_uS = 96;         // ideal is 1/16th microsecond so the whole thing is under 1 millisecond.
-const int32_t rotary_poll_interval_uS = 768; // tested at 512 microseconds and it was too short
+const int32_t key_idle_poll_interval_uS = 512;   // once idle, a full sweep of the keys takes about 8 milliseconds
+const int32_t rotary_poll_interval_uS = 768;     // checks the knob's debounce and long press deadlines
+const uint32_t key_idle_timeout_uS = 1u << 24;   // ~17 seconds without a key change before the scanner slows down
+const uint32_t low_power_timeout_uS = 1u << 29;  // ~9 minutes without any input before entering low power mode
+const uint32_t USB_MIDI_max_hold_uS = 1'000;     // one USB frame; outgoing USB MIDI waits at most this long to be batched
+const uint32_t settings_save_delay_uS = 5'000'000; // settings are saved once they have stopped changing for this long
+
+// rotary acceleration: a detent within X microseconds
+// of the previous one (same direction) counts as Y steps
+const uint32_t rotary_accel_time_uS[] = {15'000, 30'000, 60'000};
+const int8_t   rotary_accel_steps[]   = {     8,      4,      2};
+constexpr size_t rotary_accel_count = sizeof(rotary_accel_steps)/sizeof(rotary_accel_steps[0]);
 
 const uint8_t LED_frame_rate_Hz = 60;
 const uint8_t OLED_frame_rate_Hz = 24;
@@ -85,6 +96,8 @@ constexpr int32_t OLED_poll_interval_mS = 1'000 / OLED_frame_rate_Hz;
 // TO-DO: test on hardware v2
 const uint16_t default_analog_calibration_up = 480;
 const uint16_t default_analog_calibration_down = 280;
+const uint16_t min_analog_calibration_travel = 64; // ignore keys that never moved this far during calibration
+const uint8_t  analog_calibration_margin_bits = 3; // keep 1/8th of the travel as dead zone at each end
 const size_t   ledCount = 140;  // based on the size of the NeoPixel installed
 const uint8_t  default_contrast = 64; // range: 0-127
 const uint8_t  screensaver_contrast = 1; // range: 0-127
@@ -108,9 +121,9 @@ enum {
   hardwired = 1,   // read only once at startup 
   hex_button = 2, // monitor during operation
 };
-const int16_t N_A = -127;
+constexpr int16_t N_A = -127;
 // and this big data table, too, while you're at it:
-const int16_t hexBoard_layout_v1_2[keys_count][_layout_table_size] = {
+constexpr int16_t hexBoard_layout_v1_2[keys_count][_layout_table_size] = {
  //col mux switch type   x   y  pxl
   { 0,  0, hex_button, -10,  0,   0 },
   { 0,  1, hex_button,  -9, -5,  10 },
@@ -1,13 +1,80 @@
 #pragma once
+/*
+ *  Debug trace.
+ *  Code on either core logs an event as a fixed-size
+ *  binary record: event number, time, and up to two
+ *  numbers. Each core has its own ring of records, so
+ *  logging never waits on the other core, allocates,
+ *  or formats text. Core0 sends the records over serial
+ *  as lines of numbers in send(), and the host turns
+ *  them back into text with tools/trace_decode.
+ *
+ *  A ring has one writer core, but on that core an
+ *  interrupt can log in the middle of the main code
+ *  logging. A slot is reserved with interrupts off for
+ *  a few instructions (the M0+ has no atomic
+ *  read-modify-write), then filled, then marked
+ *  complete. The reader stops at a slot that is
+ *  reserved but not yet complete.
+ */
 #include <Arduino.h>
-#include <string>
+#include <cstdio>
 #include "pico/time.h"
+#include "hardware/sync.h"
+#include "trace_events.h"
 
-struct hexBoard_Debug_Object {
-  volatile uint8_t ownership;
+struct Trace_Record {
+  uint32_t timestamp;
+  uint16_t event;
+  uint16_t complete; // low bits of (slot number + 1), written last
+  int32_t  arg[2];
+};
+
+const uint32_t trace_ring_size = 64; // records per core, a power of 2
+
+struct Trace_Ring {
+  Trace_Record rec[trace_ring_size];
+  volatile uint32_t head = 0;    // slots reserved, by the writer
+  volatile uint32_t tail = 0;    // slots read, by core0
+  volatile uint32_t dropped = 0; // records lost to a full ring, by the writer
+  uint32_t dropped_reported = 0; // by core0
+
+  void write(uint16_t event, int32_t a, int32_t b) {
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t n = head;
+    bool full = (n - tail >= trace_ring_size);
+    if (full) {
+      ++dropped;
+    } else {
+      head = n + 1;
+    }
+    restore_interrupts(irq);
+    if (full) return;
+    Trace_Record& r = rec[n & (trace_ring_size - 1)];
+    r.timestamp = timer_hw->timerawl;
+    r.event  = event;
+    r.arg[0] = a;
+    r.arg[1] = b;
+    __dmb();
+    r.complete = n + 1;
+  }
+  // the oldest record if it is ready to read
+  Trace_Record* peek() {
+    uint32_t n = tail;
+    if (n == head) return nullptr;
+    Trace_Record& r = rec[n & (trace_ring_size - 1)];
+    if (r.complete != (uint16_t)(n + 1)) return nullptr;
+    __dmb();
+    return &r;
+  }
+  void pop() {
+    tail = tail + 1;
+  }
+};
 
+struct hexBoard_Debug_Object {
   bool *_ptrIsOn;
-  std::string msg;
+  Trace_Ring ring[2]; // one per core
   hexBoard_Debug_Object()  : _ptrIsOn(nullptr) {}
   bool isOn() {
     if (_ptrIsOn == nullptr) return false;
@@ -17,52 +84,41 @@ struct hexBoard_Debug_Object {
     if (_ptrIsOn == nullptr) return false;
     return !(*_ptrIsOn);
   }
-  void add(const std::string& s, bool core1 = false) {    
-    if (isOff()) return;
-    while (ownership == (core1 ? 1 : 2)) {}
-    ownership = (core1 ? 2 : 1);
-    msg += s; 
-    ownership = 0;
-  }
-  template <typename T> void add_num(T i, bool core1 = false) { 
-    if (isOff()) return;
-    while (ownership == (core1 ? 1 : 2)) {}
-    ownership = (core1 ? 2 : 1);
-    msg += std::to_string(i); 
-    msg += " ";
-    ownership = 0;
-  }
-  void timestamp(bool core1 = false) { 
+  // safe from either core, and from interrupts
+  void trace(uint16_t event, int32_t a = 0, int32_t b = 0) {
     if (isOff()) return;
-    while (ownership == (core1 ? 1 : 2)) {}
-    ownership = (core1 ? 2 : 1);
-    msg += "@ time ";
-    msg += std::to_string(timer_hw->timerawl/1000000.f);
-    msg += ": ";
-    ownership = 0;
+    ring[get_core_num()].write(event, a, b);
   }
 
   // only run by primary core
   void setStatus(bool *_ptr) {
-    while (ownership == 2) {}
-    ownership = 1;
     _ptrIsOn = _ptr;
-    ownership = 0;
-  }
-  void clear() {
-    while (ownership == 2) {}
-    ownership = 1;
-    msg.clear();
-    ownership = 0;
   }
+  // send everything ready, both cores merged in time order
   void send() {
-    if (isOn()) {
-      while (ownership == 2) {}
-      ownership = 1;
-      Serial.flush();
-      Serial.print(msg.c_str()); 
-      ownership = 0;
-      clear();
+    char line[64];
+    while (true) {
+      Trace_Record* r0 = ring[0].peek();
+      Trace_Record* r1 = ring[1].peek();
+      if (!r0 && !r1) break;
+      uint8_t c = ((r0 && r1) ? ((int32_t)(r1->timestamp - r0->timestamp) < 0) : (r1 != nullptr));
+      Trace_Record* r = (c ? r1 : r0);
+      if (isOn()) {
+        snprintf(line, sizeof(line), TRACE_RECORD_PREFIX " %u %u %u %d %d",
+          (unsigned)r->timestamp, c, r->event, (int)r->arg[0], (int)r->arg[1]);
+        Serial.println(line);
+      }
+      ring[c].pop();
     }
-  }		
-};
\ No newline at end of file
+    for (uint8_t c = 0; c < 2; ++c) {
+      uint32_t dropped = ring[c].dropped;
+      if (dropped == ring[c].dropped_reported) continue;
+      if (isOn()) {
+        snprintf(line, sizeof(line), TRACE_DROPPED_PREFIX " %u %u",
+          c, (unsigned)(dropped - ring[c].dropped_reported));
+        Serial.println(line);
+      }
+      ring[c].dropped_reported = dropped;
+    }
+  }
+};
@@ -0,0 +1,165 @@
+#pragma once
+/*
+ *  Core1 executive.
+ *  Core1 runs one loop that is driven by the clock
+ *  instead of by timer interrupts, so nothing in it
+ *  can preempt anything else. Time is cut into frames
+ *  of one audio sample. Each frame starts by waiting
+ *  for the sample deadline and rendering the sample,
+ *  then runs at most one other slot (keys, then knob)
+ *  if that slot is due and fits in the gap before the
+ *  next deadline. A slot fits if its longest run so far
+ *  is no longer than the time left. A slot that could
+ *  never fit in a frame runs as soon as it is due, and
+ *  one that keeps not fitting is let through after
+ *  exec_max_deferrals frames, so neither one starves.
+ *
+ *  The executive keeps a histogram of how late each
+ *  sample was rendered, in microseconds (the jitter),
+ *  the longest run of each slot, and how many frames
+ *  ran past the next deadline. If a frame runs long
+ *  enough to miss whole samples, they are skipped
+ *  rather than rendered in a burst, so the sample
+ *  grid stays put.
+ *
+ *  The stats are written only by core1. Core0 reads
+ *  them for the report and may see a count that is
+ *  one behind. To clear them, core0 raises a flag and
+ *  core1 clears them at the start of its next frame.
+ */
+#include <stdint.h>
+#include <Arduino.h>
+#include "pico/time.h"
+#include "config.h"
+#include "latency.h" // for Latency_Histogram
+
+enum {
+  _exec_slot_keys,
+  _exec_slot_rotary,
+  _exec_slot_count
+};
+const char* exec_slot_name[_exec_slot_count] = {
+  "keys", "knob"
+};
+
+// frames a due slot may be held back for lack of time
+const uint8_t exec_max_deferrals = 32;
+
+struct Executive_Slot {
+  uint32_t next;           // when the slot is due again
+  uint8_t  waiting;        // frames held back in a row
+  volatile uint32_t runs;
+  volatile uint32_t max_uS;
+  volatile uint32_t deferred;
+};
+
+struct hexBoard_Executive_Object {
+  uint32_t deadline;       // the next audio sample
+  uint32_t slot_start;
+  Executive_Slot slot[_exec_slot_count];
+  Latency_Histogram jitter;
+  volatile uint32_t overruns;  // frames that ran past the next deadline
+  volatile uint32_t skipped;   // audio samples never rendered
+  volatile bool clear_requested = false;
+
+  hexBoard_Executive_Object() { clear(); }
+  // only run by core1, or before it starts
+  void clear() {
+    for (auto& s : slot) {
+      s.runs = 0;
+      s.max_uS = 0;
+      s.deferred = 0;
+    }
+    jitter.clear();
+    overruns = 0;
+    skipped = 0;
+  }
+  // run on core1 before the loop
+  void begin() {
+    uint32_t right_now = timer_hw->timerawl;
+    deadline = right_now + audio_sample_interval_uS;
+    for (auto& s : slot) {
+      s.next = right_now;
+      s.waiting = 0;
+    }
+  }
+  // run by primary core; core1 does the clearing
+  void request_clear() {
+    clear_requested = true;
+  }
+  // wait for the audio deadline, then set the next one
+  void wait_for_tick() {
+    if (clear_requested) {
+      clear();
+      clear_requested = false;
+    }
+    uint32_t right_now;
+    do {
+      right_now = timer_hw->timerawl;
+    } while ((int32_t)(right_now - deadline) < 0);
+    uint32_t late = right_now - deadline;
+    jitter.record(late);
+    if (late >= audio_sample_interval_uS) {
+      uint32_t missed = late / audio_sample_interval_uS;
+      skipped += missed;
+      deadline += missed * audio_sample_interval_uS;
+    }
+    deadline += audio_sample_interval_uS;
+  }
+  // true if the slot is due and there is time to run it
+  // before the next deadline
+  bool slot_ready(uint8_t s) {
+    slot_start = timer_hw->timerawl;
+    Executive_Slot& x = slot[s];
+    if ((int32_t)(slot_start - x.next) < 0) return false;
+    int32_t time_left = deadline - slot_start;
+    if (((int32_t)x.max_uS <= time_left)
+     || ((int32_t)x.max_uS >= audio_sample_interval_uS)
+     || (x.waiting >= exec_max_deferrals)) {
+      x.waiting = 0;
+      return true;
+    }
+    ++x.waiting;
+    ++x.deferred;
+    return false;
+  }
+  // the slot is next due this many microseconds after it finished
+  void finish_slot(uint8_t s, uint32_t interval_uS) {
+    uint32_t right_now = timer_hw->timerawl;
+    uint32_t elapsed = right_now - slot_start;
+    ++slot[s].runs;
+    if (elapsed > slot[s].max_uS) { slot[s].max_uS = elapsed; }
+    slot[s].next = right_now + interval_uS;
+  }
+  void end_frame() {
+    if ((int32_t)(timer_hw->timerawl - deadline) > 0) { ++overruns; }
+  }
+
+  // only run by primary core
+  void dump() {
+    Serial.print("audio tick: n=");
+    Serial.print(jitter.count);
+    Serial.print(" late max=");
+    Serial.print(jitter.max_uS);
+    Serial.print("uS overruns=");
+    Serial.print(overruns);
+    Serial.print(" skipped=");
+    Serial.println(skipped);
+    for (uint8_t b = 0; b < latency_bucket_count; ++b) {
+      if (!jitter.bucket[b]) continue;
+      Serial.print("  <");
+      Serial.print(1u << b);
+      Serial.print("uS: ");
+      Serial.println(jitter.bucket[b]);
+    }
+    for (uint8_t s = 0; s < _exec_slot_count; ++s) {
+      Serial.print(exec_slot_name[s]);
+      Serial.print(": n=");
+      Serial.print(slot[s].runs);
+      Serial.print(" max=");
+      Serial.print(slot[s].max_uS);
+      Serial.print("uS deferred=");
+      Serial.println(slot[s].deferred);
+    }
+  }
+};
@@ -1,55 +1,385 @@
 #pragma once
+#include <string.h>
+#include <string>
 #include "settings.h"
 #include "LittleFS.h"       // code to use flash drive space as a file system -- not implemented yet, as of May 2024
 #include "debug.h"
+#include "keys.h"
+#include "pico/multicore.h"
 
 bool fileSystemExists;
 
+// core1 runs its code from flash, and flash cannot be read
+// while LittleFS erases or programs it, so core1 is parked
+// for the length of every write. core1 was not started by
+// the framework (no setup1/loop1), so the framework will not
+// park it; it registers itself as a lockout victim instead,
+// whose handler waits in RAM, and then sets this flag.
+// before that core1 is not running and there is nothing to park.
+volatile bool core1_lockout_ready = false;
+
+// hold one of these in scope around any LittleFS call that
+// writes: open for write, write, close, rename, remove, format.
+// the audio stops for the length of the write.
+struct Flash_Write_Lock {
+  bool locked;
+  Flash_Write_Lock() : locked(core1_lockout_ready) {
+    if (locked) multicore_lockout_start_blocking();
+  }
+  ~Flash_Write_Lock() {
+    if (locked) multicore_lockout_end_blocking();
+  }
+};
+
+// CRC-32 (the zip/PNG one), a nibble at a time
+// to keep the table small. pass the last result
+// back in as crc to continue over several blocks.
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  static const uint32_t nibble_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = nibble_table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = nibble_table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
 void mount_file_system() {
   fileSystemExists = true;
   if (LittleFS.begin()) return;
-  debug.add("LittleFS could not mount; re-formatting storage space.\n");
+  debug.trace(_trace_fs_reformat);
+  Flash_Write_Lock lock;
   if (LittleFS.format()) return;
   fileSystemExists = false;
-  debug.add("That's odd, there was even a problem re-formatting.\n");
+  debug.trace(_trace_fs_format_failed);
+}
+
+// settings file: a header, the number of records, then
+// one record per setting (its stable ID and its 8 bytes),
+// then a CRC32 of everything before it. records are
+// matched by ID, so settings can be added or reordered
+// without shifting saved values; unknown IDs are skipped.
+// a file with no header is the old format, one 8 byte
+// value per setting in enum order, and is migrated. the
+// old format always held all 68 settings of its time, so
+// a headerless file of any other length is not trusted.
+//
+// after that come any number of update blocks, each the
+// record count, the changed records and a CRC32 of the
+// block. small changes are appended as an update; when
+// the file would outgrow the buffer it is rewritten whole.
+const uint8_t settings_file_header[] = {'H','X','S','T', 1};
+constexpr size_t settings_file_header_size = sizeof(settings_file_header);
+constexpr size_t settings_record_size = 1 + bytes_per_setting;
+constexpr size_t settings_file_max_size = settings_file_header_size + 1
+                                        + 255 * settings_record_size + 4;
+// kept off the stack. the whole file is built here
+// and written in one call.
+uint8_t settings_file_buffer[settings_file_max_size];
+constexpr size_t legacy_settings_file_size = 68 * bytes_per_setting;
+// bytes of valid blocks in the file, or 0 if the next
+// save must rewrite the whole file
+size_t settings_file_size = 0;
+
+void apply_settings_records(hexBoard_Setting_Array& refS, const uint8_t* r, size_t count) {
+  uint8_t indexOf[256];
+  memset(indexOf, UINT8_MAX, sizeof(indexOf));
+  for (size_t i = 0; i < _settingSize; ++i) {
+    indexOf[setting_ID[i]] = i;
+  }
+  for (size_t i = 0; i < count; ++i, r += settings_record_size) {
+    uint8_t p = indexOf[r[0]];
+    if (p == UINT8_MAX) continue; // from a newer firmware
+    memcpy(refS[p].w.data(), r + 1, bytes_per_setting);
+  }
+}
+
+// the old file's record order is the ID order
+bool load_legacy_settings(hexBoard_Setting_Array& refS, const uint8_t* b, size_t len) {
+  if (len != legacy_settings_file_size) return false;
+  size_t count = len / bytes_per_setting;
+  for (size_t i = 0; i < _settingSize; ++i) {
+    if (setting_ID[i] >= count) continue;
+    memcpy(refS[i].w.data(), b + setting_ID[i] * bytes_per_setting, bytes_per_setting);
+  }
+  return true;
 }
 
 bool load_settings(hexBoard_Setting_Array& refS, const char* FN) {
   if (!fileSystemExists) return false;
-  File f = LittleFS.open(FN,"r+");
+  File f = LittleFS.open(FN,"r");
   if (!f) {
-    debug.add("Settings file did not exist.\n");
+    debug.trace(_trace_settings_missing);
+    return false;
+  }
+  uint8_t* b = settings_file_buffer;
+  size_t len = f.read(b, settings_file_max_size);
+  f.close();
+  // e.g. a power cut while the file was first created;
+  // treated as no file, so the hardwired defaults apply
+  if (len == 0) {
+    debug.trace(_trace_settings_missing);
     return false;
   }
-  int p = 0;
-  while (f.available()) {
-    std::array<uint8_t, bytes_per_setting> b;
-    for (int i = 0; i < bytes_per_setting; ++i) {
-      b[i] = f.read();
+  bool isLegacy = (len < settings_file_header_size)
+    || memcmp(b, settings_file_header, settings_file_header_size);
+  if (isLegacy) {
+    if (!load_legacy_settings(refS, b, len)) {
+      debug.trace(_trace_settings_invalid);
+      return false;
     }
-    refS[p].w = b;
-    ++p;
+    debug.trace(_trace_settings_migrated);
+    settings_file_size = 0;
+    refS[_defaults].b = false;
+    refS[_changed].b = true; // rewrite it in the new format
+    return true;
+  }
+  size_t count = b[settings_file_header_size];
+  size_t crcAt = settings_file_header_size + 1 + count * settings_record_size;
+  uint32_t crc = 0;
+  if (len >= crcAt + 4) {
+    memcpy(&crc, b + crcAt, 4);
+  }
+  if ((len < crcAt + 4) || (crc != crc32(b, crcAt))) {
+    debug.trace(_trace_settings_damaged);
+    return false;
+  }
+  apply_settings_records(refS, b + settings_file_header_size + 1, count);
+  // then the updates, in the order they were saved
+  size_t at = crcAt + 4;
+  while (at < len) {
+    count = b[at];
+    crcAt = at + 1 + count * settings_record_size;
+    if (crcAt + 4 > len) break;
+    memcpy(&crc, b + crcAt, 4);
+    if (crc != crc32(b + at, crcAt - at)) break;
+    apply_settings_records(refS, b + at + 1, count);
+    at = crcAt + 4;
   }
+  // an update cut short by a power loss is dropped, and
+  // the next save rewrites the file without it
+  settings_file_size = (at == len ? len : 0);
   refS[_defaults].b = false; // so that we don't try to overwrite with hardwire
   refS[_changed].b = false;
-  debug.add("Settings loaded from file.\n");
+  debug.trace(_trace_settings_loaded);
+  return true;
+}
+
+// written to a temporary file which then replaces the
+// old one, so a power cut mid-save leaves the old file.
+bool save_settings(hexBoard_Setting_Array& refS, const char* FN) {
+  if (!refS[_changed].b) return true;
+  if (!fileSystemExists) return false;
+  uint8_t* b = settings_file_buffer;
+  memcpy(b, settings_file_header, settings_file_header_size);
+  size_t at = settings_file_header_size;
+  b[at++] = _settingSize;
+  for (size_t i = 0; i < _settingSize; ++i) {
+    b[at++] = setting_ID[i];
+    memcpy(b + at, refS[i].w.data(), bytes_per_setting);
+    at += bytes_per_setting;
+  }
+  uint32_t crc = crc32(b, at);
+  memcpy(b + at, &crc, 4);
+  at += 4;
+  std::string tempFN = std::string(FN) + ".tmp";
+  Flash_Write_Lock lock;
+  File f = LittleFS.open(tempFN.c_str(),"w");
+  if (!f) {
+    debug.trace(_trace_settings_save_error);
+    return false;
+  }
+  size_t bytesWritten = f.write(b, at);
+  f.close();
+  if ((bytesWritten != at) || !LittleFS.rename(tempFN.c_str(), FN)) {
+    debug.trace(_trace_settings_save_error);
+    LittleFS.remove(tempFN.c_str());
+    return false;
+  }
+  settings_file_size = at;
+  refS[_changed].b = false;
+  return true;
+}
+
+// append the settings marked in dirty as an update block.
+// returns false, having written nothing, if the file has
+// to be rewritten whole instead.
+bool append_settings_update(hexBoard_Setting_Array& refS, const char* FN, const bool* dirty) {
+  if (!fileSystemExists) return false;
+  if (!settings_file_size) return false;
+  uint8_t* b = settings_file_buffer;
+  size_t at = 1;
+  for (size_t i = 0; i < _settingSize; ++i) {
+    if (!dirty[i]) continue;
+    b[at++] = setting_ID[i];
+    memcpy(b + at, refS[i].w.data(), bytes_per_setting);
+    at += bytes_per_setting;
+  }
+  b[0] = (at - 1) / settings_record_size;
+  uint32_t crc = crc32(b, at);
+  memcpy(b + at, &crc, 4);
+  at += 4;
+  if (settings_file_size + at > settings_file_max_size) return false;
+  Flash_Write_Lock lock;
+  File f = LittleFS.open(FN,"a");
+  if (!f) return false;
+  size_t bytesWritten = f.write(b, at);
   f.close();
+  if (bytesWritten != at) {
+    settings_file_size = 0; // rewrite it next time
+    return false;
+  }
+  settings_file_size += at;
+  refS[_changed].b = false;
   return true;
 }
 
-void save_settings(hexBoard_Setting_Array& refS, const char* FN) {
-  if (!refS[_changed].b) return;
-  if (!fileSystemExists) return;
-  File f = LittleFS.open(FN,"w+");
+// keeps track of which settings changed and saves them
+// once they have been left alone for a while. a flash
+// write parks core1 for milliseconds (see Flash_Write_Lock),
+// so the caller only lets it save when the synth is silent.
+struct hexBoard_Settings_Saver {
+  bool     dirty[_settingSize] = {};
+  bool     rewrite = false;   // save the whole file, not an update
+  uint32_t last_change = 0;
+  // wear and timing, since power on
+  uint32_t updates = 0;       // update blocks appended
+  uint32_t rewrites = 0;      // whole file written
+  uint32_t failures = 0;
+  uint32_t bytes_written = 0;
+  uint32_t last_write_uS = 0;
+  uint32_t max_write_uS = 0;
+
+  void mark(hexBoard_Setting_Array& refS, int s) {
+    if ((s < 0) || (s >= _settingSize)) return;
+    dirty[s] = true;
+    refS[_changed].b = true;
+    last_change = timer_hw->timerawl;
+  }
+  void mark_all(hexBoard_Setting_Array& refS) {
+    rewrite = true;
+    refS[_changed].b = true;
+    last_change = timer_hw->timerawl;
+  }
+
+  // call from loop()
+  void poll(hexBoard_Setting_Array& refS, const char* FN, bool quiet) {
+    if (!refS[_changed].b) return;
+    if (!quiet) return;
+    if (timer_hw->timerawl - last_change < settings_save_delay_uS) return;
+    uint32_t start_time = timer_hw->timerawl;
+    size_t sizeBefore = settings_file_size;
+    bool saved = !rewrite && append_settings_update(refS, FN, dirty);
+    if (saved) {
+      ++updates;
+      bytes_written += settings_file_size - sizeBefore;
+    } else if (save_settings(refS, FN)) {
+      saved = true;
+      ++rewrites;
+      bytes_written += settings_file_size;
+    }
+    last_write_uS = timer_hw->timerawl - start_time;
+    if (last_write_uS > max_write_uS) { max_write_uS = last_write_uS; }
+    if (!saved) {
+      ++failures;
+      last_change = timer_hw->timerawl; // try again later
+      return;
+    }
+    memset(dirty, 0, sizeof(dirty));
+    rewrite = false;
+    debug.trace(_trace_settings_saved, last_write_uS);
+  }
+
+  // only run by primary core
+  void dump() {
+    Serial.print("settings: updates=");
+    Serial.print(updates);
+    Serial.print(" rewrites=");
+    Serial.print(rewrites);
+    Serial.print(" failures=");
+    Serial.print(failures);
+    Serial.print(" bytes=");
+    Serial.print(bytes_written);
+    Serial.print(" file=");
+    Serial.print(settings_file_size);
+    Serial.print(" last=");
+    Serial.print(last_write_uS);
+    Serial.print("uS max=");
+    Serial.print(max_write_uS);
+    Serial.println("uS");
+  }
+};
+
+// key calibration table: a short header followed by
+// the high and low threshold of every key, in the
+// order of their linear index, as little-endian words.
+const uint8_t key_calibration_header[] = {'H','X','K','C', 1, keys_count};
+constexpr size_t key_calibration_header_size = sizeof(key_calibration_header);
+constexpr size_t key_calibration_file_size = key_calibration_header_size + 4 * keys_count;
+
+bool load_key_calibration(hexBoard_Key_Object& refK, const char* FN) {
+  if (!fileSystemExists) return false;
+  File f = LittleFS.open(FN,"r");
   if (!f) {
-    debug.add("An Error has occurred while saving settings\n");        
+    debug.trace(_trace_calibration_missing);
+    return false;
+  }
+  std::array<uint8_t, key_calibration_file_size> b;
+  size_t bytesRead = f.read(b.data(), b.size());
+  f.close();
+  if ((bytesRead != b.size())
+   || (memcmp(b.data(), key_calibration_header, key_calibration_header_size))) {
+    debug.trace(_trace_calibration_invalid);
+    return false;
   }
-  for (int i = 0; i < _settingSize; ++i) {
-    for (int j = 0; j < bytes_per_setting; ++j) {
-      f.write((refS[i].w)[j]);
+  for (size_t i = 0; i < col_pins_count; ++i) {
+    for (size_t j = 0; j < mux_channels_count; ++j) {
+      size_t at = key_calibration_header_size + 4 * linear_index(j,i);
+      uint16_t hi = b[at]     | (b[at + 1] << 8);
+      uint16_t lo = b[at + 2] | (b[at + 3] << 8);
+      refK.recalibrate(j, i, hi, lo);
+    }
+  }
+  debug.trace(_trace_calibration_loaded);
+  return true;
+}
+
+bool save_key_calibration(hexBoard_Key_Object& refK, const char* FN) {
+  if (!fileSystemExists) return false;
+  std::array<uint8_t, key_calibration_file_size> b;
+  memcpy(b.data(), key_calibration_header, key_calibration_header_size);
+  for (size_t i = 0; i < col_pins_count; ++i) {
+    for (size_t j = 0; j < mux_channels_count; ++j) {
+      size_t at = key_calibration_header_size + 4 * linear_index(j,i);
+      uint16_t hi = refK.get_high(j,i);
+      uint16_t lo = refK.get_low(j,i);
+      b[at]     = hi & 0xFF;
+      b[at + 1] = hi >> 8;
+      b[at + 2] = lo & 0xFF;
+      b[at + 3] = lo >> 8;
     }
   }
-  debug.add("settings saved\n");
+  // written to a temporary file which then replaces the
+  // old table, so a power cut mid-save leaves the old one
+  std::string tempFN = std::string(FN) + ".tmp";
+  Flash_Write_Lock lock;
+  File f = LittleFS.open(tempFN.c_str(),"w");
+  if (!f) {
+    debug.trace(_trace_calibration_save_error);
+    return false;
+  }
+  size_t bytesWritten = f.write(b.data(), b.size());
   f.close();
-  refS[_changed].b = false;
+  if ((bytesWritten != b.size()) || !LittleFS.rename(tempFN.c_str(), FN)) {
+    debug.trace(_trace_calibration_save_error);
+    LittleFS.remove(tempFN.c_str());
+    return false;
+  }
+  debug.trace(_trace_calibration_saved);
+  return true;
 }
\ No newline at end of file
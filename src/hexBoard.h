@@ -1,12 +1,18 @@
 #pragma once
 #include <array>
 #include <stdint.h>
-#include <map>
 #include "settings.h"
 #include "hexagon.h"
 #include "music.h"
+#include "synth.h"
 
-struct Button {
+// the grid is stored as three parallel arrays, grouped by
+// who touches the data and how often, so that a loop over
+// one group does not drag the others through the cache.
+
+// layout data: written when a layout is generated, read
+// when a key is pressed and by the HUD.
+struct Button_Layout_Data {
   // basic identification
   bool      isUsed = false;  // is it a button or a hardwired circuit
   int8_t    atMux  = -1;
@@ -25,23 +31,32 @@ struct Button {
   int8_t    scaleDegree = 0;  // for 1-dimension
   int8_t    smallDegree = 0;  // # of small steps (microtonal / MOS)
   int8_t    largeDegree = 0;  // # of large steps (microtonal / MOS)
+  int8_t    paletteNum = 0;   // used for tiered key coloring (all except JI)
+  double    centsFromAnchor = 0.0; // pitch relative to the anchor note, before transposing
 
   // MIDI and pitch assignment
   uint8_t   midiCh = 0;      // what channel assigned (if not MPE mode)   [1..16]
   uint8_t   midiTuningTable = 255; // assigned MIDI note (if MTS mode) [0..127]
-  double    midiPitch = 0.0; // pitch, 69 = A440, every 1.0 is 100.0 cents
-  double    frequency = 0.0; // equivalent of pitch in Hz
+  uint8_t   midiNote = 0;    // nearest MIDI pitch, 0 to 128
+  int16_t   midiBend = 0;    // pitch bend for MPE purposes
+  cents_fx  pitch = 0;       // cents above MIDI note 0 in Q16, 6900 << 16 = A440
+  Synth_Voice_Start voice_start; // ready-made synth note-on
   uint8_t   cmd = 0;  // control parameter corresponding to this hex
+};
 
-  // palette and cached LED codes
-  int8_t    paletteNum = 0;  // used for tiered key coloring (all except JI)
+// cached LED codes: written with the layout, read
+// every LED frame.
+struct Button_LED_Codes {
   uint32_t  LEDcodeBase = 0; // calculate it once and store value, to make LED playback snappier 
   uint32_t  LEDcodeAnim = 0; // calculate it once and store value, to make LED playback snappier 
   uint32_t  LEDcodePlay = 0; // calculate it once and store value, to make LED playback snappier
   uint32_t  LEDcodeRest = 0; // calculate it once and store value, to make LED playback snappier
   uint32_t  LEDcodeOff  = 0; // calculate it once and store value, to make LED playback snappier
   uint32_t  LEDcodeDim  = 0; // calculate it once and store value, to make LED playback snappier
+};
 
+// play state: written on every key event.
+struct Button_Play_State {
   // key press data
   uint32_t  timeLastUpdate = 0; // store time that key level was last updated
   uint32_t  timePressBegan = 0; // store time that full press occurred
@@ -53,8 +68,8 @@ struct Button {
 
   // music playback status
   uint8_t   midiChPlaying  = 0;          // what midi channel is there currrently a note-on
-  uint8_t   midiNote = 0;    // nearest MIDI pitch, 0 to 128
-  int16_t   midiBend = 0;    // pitch bend for MPE purposes
+  uint8_t   midiNotePlaying = 0;         // the note number it was sent with
+  uint8_t   externalNotes  = 0;          // incoming MIDI notes mapped to this key
   uint8_t   synthChPlaying = 0;         // what synth channel is there currrently a note-on
 
   // member functions
@@ -90,39 +105,171 @@ struct Button {
   }
 };
 
+// a view of one button across the three arrays.
+// cheap to pass by value.
+struct Button {
+  Button_Layout_Data& layout;
+  Button_Play_State&  play;
+  Button_LED_Codes&   LED;
+};
+
 
 
 void hardwired_switch_handler(int16_t ID);
 
+// the bounding box of hex coordinates used by the layout
+constexpr int16_t layout_extent(const int16_t (&layout)[keys_count][_layout_table_size],
+                                uint8_t column, bool find_max) {
+  int16_t result = (find_max ? INT16_MIN : INT16_MAX);
+  for (size_t i = 0; i < keys_count; ++i) {
+    if (layout[i][_layout_table_switch_type] != hex_button) continue;
+    int16_t v = layout[i][column];
+    if (find_max ? (v > result) : (v < result)) { result = v; }
+  }
+  return result;
+}
+constexpr int16_t grid_min_x = layout_extent(hexBoard_layout_v1_2, _layout_table_coord_x, false);
+constexpr int16_t grid_max_x = layout_extent(hexBoard_layout_v1_2, _layout_table_coord_x, true);
+constexpr int16_t grid_min_y = layout_extent(hexBoard_layout_v1_2, _layout_table_coord_y, false);
+constexpr int16_t grid_max_y = layout_extent(hexBoard_layout_v1_2, _layout_table_coord_y, true);
+constexpr size_t  grid_width  = grid_max_x - grid_min_x + 1;
+constexpr size_t  grid_height = grid_max_y - grid_min_y + 1;
+constexpr size_t  grid_index(int x, int y) {
+  return (y - grid_min_y) * grid_width + (x - grid_min_x);
+}
+
+// the farthest any two buttons are from each other
+constexpr uint8_t layout_diameter(const int16_t (&layout)[keys_count][_layout_table_size]) {
+  int result = 0;
+  for (size_t i = 0; i < keys_count; ++i) {
+    if (layout[i][_layout_table_switch_type] != hex_button) continue;
+    for (size_t j = i + 1; j < keys_count; ++j) {
+      if (layout[j][_layout_table_switch_type] != hex_button) continue;
+      int d = hex_distance(layout[i][_layout_table_coord_x] - layout[j][_layout_table_coord_x],
+                           layout[i][_layout_table_coord_y] - layout[j][_layout_table_coord_y]);
+      if (d > result) { result = d; }
+    }
+  }
+  return result;
+}
+constexpr uint8_t grid_diameter = layout_diameter(hexBoard_layout_v1_2);
+constexpr uint8_t no_neighbor = UINT8_MAX;
+constexpr uint8_t no_pixel    = UINT8_MAX;
+
+// lookup tables from switch (linear index) and from hex
+// coordinate to the button's position in the grid array,
+// computed at compile time so that each lookup is one load.
+// buttons are numbered by their pixel ID, with hard switches
+// following, and the remaining unused inputs at the back.
+// coordinates that are not a button map to -1.
+// 
+// for spatial features (animations, chord shapes) each 
+// button pixel also gets its neighbor in each of the six
+// unitHex directions (no_neighbor at the edge), and a list
+// of every button sorted by distance from it: the buttons
+// exactly d steps away are ring_order[p][ring_start[p][d]] 
+// up to but not including ring_order[p][ring_start[p][d+1]].
+// pixel numbers go past 127 so these are stored unsigned.
+struct hexBoard_Lookup_Tables {
+  int16_t index_to_pixel[keys_count];
+  int16_t coord_to_pixel[grid_width * grid_height];
+  uint8_t neighbor[ledCount][6];
+  uint8_t ring_order[ledCount][ledCount];
+  uint8_t ring_start[ledCount][grid_diameter + 2];
+};
+constexpr hexBoard_Lookup_Tables build_lookup_tables(
+  const int16_t (&layout)[keys_count][_layout_table_size]) {
+  hexBoard_Lookup_Tables t = {};
+  for (auto& c : t.coord_to_pixel) { c = -1; }
+  int16_t hardwireIndex = ledCount;
+  int16_t unusedIndex = keys_count - 1;
+  for (size_t i = 0; i < keys_count; ++i) {
+    size_t L = linear_index(
+      layout[i][_layout_table_multiplex_value],
+      layout[i][_layout_table_column_pin]
+    );
+    switch (layout[i][_layout_table_switch_type]) {
+      case hex_button: {
+        int16_t p = layout[i][_layout_table_pixel_number];
+        t.coord_to_pixel[grid_index(layout[i][_layout_table_coord_x],
+                                    layout[i][_layout_table_coord_y])] = p;
+        t.index_to_pixel[L] = p;
+        break;
+      }
+      case hardwired:
+        t.index_to_pixel[L] = hardwireIndex;
+        ++hardwireIndex;
+        break;
+      default:
+        t.index_to_pixel[L] = unusedIndex;
+        --unusedIndex;
+        break;
+    }
+  }
+  int16_t pixel_x[ledCount] = {};
+  int16_t pixel_y[ledCount] = {};
+  bool    has_coord[ledCount] = {};
+  for (size_t i = 0; i < keys_count; ++i) {
+    if (layout[i][_layout_table_switch_type] != hex_button) continue;
+    int16_t p = layout[i][_layout_table_pixel_number];
+    pixel_x[p] = layout[i][_layout_table_coord_x];
+    pixel_y[p] = layout[i][_layout_table_coord_y];
+    has_coord[p] = true;
+  }
+  for (size_t p = 0; p < ledCount; ++p) {
+    for (uint8_t dir = 0; dir < 6; ++dir) {
+      t.neighbor[p][dir] = no_neighbor;
+      if (!has_coord[p]) continue;
+      int x = pixel_x[p] + unitHex_x[dir];
+      int y = pixel_y[p] + unitHex_y[dir];
+      if ((x < grid_min_x) || (x > grid_max_x)) continue;
+      if ((y < grid_min_y) || (y > grid_max_y)) continue;
+      int16_t n = t.coord_to_pixel[grid_index(x, y)];
+      if (n >= 0) { t.neighbor[p][dir] = n; }
+    }
+    uint8_t count = 0;
+    for (uint8_t d = 0; d <= grid_diameter; ++d) {
+      t.ring_start[p][d] = count;
+      if (!has_coord[p]) continue;
+      for (size_t q = 0; q < ledCount; ++q) {
+        if (!has_coord[q]) continue;
+        if (hex_distance(pixel_x[q] - pixel_x[p], pixel_y[q] - pixel_y[p]) != d) continue;
+        t.ring_order[p][count] = q;
+        ++count;
+      }
+    }
+    t.ring_start[p][grid_diameter + 1] = count;
+  }
+  return t;
+}
+constexpr hexBoard_Lookup_Tables hexBoard_lookup_v1_2 = build_lookup_tables(hexBoard_layout_v1_2);
+
 struct hexBoard_Grid_Object {
-  std::array<Button, keys_count> btn;
-  std::map<Hex,      int16_t>    coord_to_pixel;
-  std::map<uint8_t,  int16_t>    index_to_pixel;
-  wave_tbl                       cached_waveform;
-
-  hexBoard_Grid_Object(const int16_t layout[keys_count][_layout_table_size]) {
-    // first count how many rows represent usable inputs,
-    // how many of these are buttons vs. hard switches,
-    // and the largest pixel number used in the grid.
-    // buttons will be numbered by their pixel ID, with
-    // hard switches following, and the remaining
-    // unused inputs initialized empty at the back of the array
-    size_t hardwireIndex = ledCount;
-    size_t unusedIndex = keys_count - 1;
+  std::array<Button_Layout_Data, keys_count> layout_data;
+  std::array<Button_Play_State,  keys_count> play_state;
+  std::array<Button_LED_Codes,   keys_count> LED_codes;
+  const hexBoard_Lookup_Tables&  lookup;
+  // two copies of the cached waveform: a new one is built in
+  // the spare while voices keep reading the current one
+  wave_tbl                       cached_waveform[2];
+  uint8_t                        cached_current = 0;
+  hybrid_wave_bank               hybrid_bank;
+  uint8_t                        note_to_pixel[128]; // key to light for an incoming MIDI note
 
+  hexBoard_Grid_Object(const int16_t layout[keys_count][_layout_table_size],
+                       const hexBoard_Lookup_Tables& tables) 
+  : lookup(tables) {
     for (size_t i = 0; i < keys_count; ++i) {
       size_t L = linear_index(
         layout[i][_layout_table_multiplex_value],
         layout[i][_layout_table_column_pin]
       );      
+      int16_t p = lookup.index_to_pixel[L];
       switch (layout[i][_layout_table_switch_type]) {
         case hex_button: {
-          int16_t p = layout[i][_layout_table_pixel_number];
           Hex h = {layout[i][_layout_table_coord_x],
                    layout[i][_layout_table_coord_y]};
-          coord_to_pixel[h] = p;
-          index_to_pixel[L] = p;
-          Button* b = &btn[p];
+          Button_Layout_Data* b = &layout_data[p];
           b->coord  = h;
           b->pixel  = p;
           b->isUsed = true;
@@ -132,57 +279,75 @@ struct hexBoard_Grid_Object {
           // eventually will load saved values or put a default
           /* placeholder to put note values for testing */
           b->isNote          = true;
-          b->LEDcodeBase     = 0x00000000; // for now
-          b->LEDcodeAnim     = 0x00000000; // calculate it once and store value, to make LED playback snappier 
-          b->LEDcodePlay     = 0x00000000; // calculate it once and store value, to make LED playback snappier
-          b->LEDcodeRest     = 0x00000000; // calculate it once and store value, to make LED playback snappier
-          b->LEDcodeOff      = 0; // calculate it once and store value, to make LED playback snappier
-          b->LEDcodeDim      = 0x00000000; // calculate it once and store value, to make LED playback snappier
-          b->frequency       = 10.0 + (b->pixel * 10.0); // equivalent pitch in Hz
           b->midiCh          = 1;      // what channel assigned (if not MPE mode)   [1..16]
           b->midiTuningTable = 255; // assigned MIDI note (if MTS mode) [0..127]
           b->scaleEquave     = 0;
           b->scaleDegree     = 0;     // order in scale relative to equave
           b->inScale         = true; // for scale-lock purposes
           b->cmd             = 0;  // control parameter corresponding to this hex
-          b->midiPitch       = 69.0;
+          b->pitch           = 69 * cents_fx_per_semitone;
           b->midiNote        = 69;
           b->midiBend        = 0;
 
           break;
         }
         case hardwired: {
-          index_to_pixel[L] = hardwireIndex;
-          btn[hardwireIndex].isUsed = true;
-          btn[hardwireIndex].atMux  = layout[i][_layout_table_multiplex_value];
-          btn[hardwireIndex].atCol  = layout[i][_layout_table_column_pin];
-          ++hardwireIndex;
+          layout_data[p].isUsed = true;
+          layout_data[p].atMux  = layout[i][_layout_table_multiplex_value];
+          layout_data[p].atCol  = layout[i][_layout_table_column_pin];
           break;
         }
         default:
-          index_to_pixel[L] = unusedIndex;
-          --unusedIndex;
           break;
       }
     }
   }
 
-  Button& button_at_coord(const Hex& coord) {
-    return btn[coord_to_pixel.at(coord)];
+  Button button_at_pixel(size_t p) {
+    return {layout_data[p], play_state[p], LED_codes[p]};
+  }
+
+  // check in_bounds() first
+  Button button_at_coord(const Hex& coord) {
+    return button_at_pixel(lookup.coord_to_pixel[grid_index(coord.x, coord.y)]);
+  }
+
+  Button button_at_linear_index(size_t l_index) {
+    return button_at_pixel(lookup.index_to_pixel[l_index]);
   }
 
-  Button& button_at_linear_index(size_t l_index) {
-    return btn[index_to_pixel.at(l_index)];
+  // pixel one step away in a unitHex direction, or no_neighbor
+  uint8_t neighbor_of(size_t p, uint8_t dir) {
+    return lookup.neighbor[p][dir];
+  }
+
+  // the buttons exactly d steps from pixel p
+  const uint8_t* ring_begin(size_t p, uint8_t d) {
+    return &lookup.ring_order[p][lookup.ring_start[p][d]];
+  }
+  const uint8_t* ring_end(size_t p, uint8_t d) {
+    return &lookup.ring_order[p][lookup.ring_start[p][d + 1]];
   }
 
   bool in_bounds(const Hex& coord) {
-    return (coord_to_pixel.find(coord) != coord_to_pixel.end());
+    if ((coord.x < grid_min_x) || (coord.x > grid_max_x)) return false;
+    if ((coord.y < grid_min_y) || (coord.y > grid_max_y)) return false;
+    return (lookup.coord_to_pixel[grid_index(coord.x, coord.y)] >= 0);
   }
 
-  void set_cached_wavetable(const wave_tbl& inputWaveTbl) {
-    for (uint8_t i = 0; i < 256; ++i) {
-      cached_waveform[i] = inputWaveTbl[i];
-    }
+  // Synth_Voice_Start::wavetable -> the table a voice plays
+  const int8_t* wavetable(uint8_t index) {
+    return (index ? hybrid_bank[index - 1].data() : cached_waveform[cached_current].data());
+  }
+  // build the next waveform in here, then swap_waveform()
+  wave_tbl& spare_waveform() {
+    return cached_waveform[cached_current ^ 1];
+  }
+  // returns the table that was current, which becomes the spare
+  const int8_t* swap_waveform() {
+    const int8_t* old = cached_waveform[cached_current].data();
+    cached_current ^= 1;
+    return old;
   }
 
 };
\ No newline at end of file
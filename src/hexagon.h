@@ -64,6 +64,21 @@ Hex unitHex[] = {
   // E       NE      NW      W       SW      SE
   { 2, 0},{ 1,-1},{-1,-1},{-2, 0},{-1, 1},{ 1, 1}
 };
+// same directions, usable at compile time
+constexpr int unitHex_x[] = { 2, 1,-1,-2,-1, 1};
+constexpr int unitHex_y[] = { 0,-1,-1, 0, 1, 1};
+
+// number of steps between two hexes. in these "doubled"
+// coordinates each vertical step also covers one x unit,
+// and the rest of the x distance is covered two at a time.
+constexpr int hex_distance(int dx, int dy) {
+  dx = (dx < 0 ? -dx : dx);
+  dy = (dy < 0 ? -dy : dy);
+  return dy + (dx > dy ? (dx - dy) / 2 : 0);
+}
+int hex_distance(const Hex& A, const Hex& B) {
+  return hex_distance(A.x - B.x, A.y - B.y);
+}
 
 struct axial_Hex {
   int a;
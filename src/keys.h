@@ -22,6 +22,10 @@ struct Key_Msg {
 };
 queue_t key_press_queue;
 
+// one bit per column for each mux channel, 160 bits in all.
+// a key whose bit is clear is not read by the scanner.
+using Key_Enable_Mask = std::array<uint16_t, mux_channels_count>;
+
 class hexBoard_Key_Object {
 protected:
   bool            active;         // is the object ready to run in the background
@@ -35,7 +39,19 @@ protected:
   std::array<uint16_t, keys_count> high;
   std::array<uint16_t, keys_count> low;
   std::array<uint16_t, keys_count> invert_range;
+  Key_Enable_Mask enabled;        // e.g. scale lock
   int8_t ownership; // -1 = no one, 0 = core0, 1 = core1
+  // calibration mode: instead of sending key messages,
+  // record the highest (at rest) and lowest (bottomed out)
+  // reading seen on each analog key.
+  bool            calibrating;
+  std::array<uint16_t, keys_count> cal_rest;
+  std::array<uint16_t, keys_count> cal_down;
+  // adaptive scan rate: once no key has changed for a while
+  // the scanner reports that it is idle, and the caller
+  // should poll at the slower rate until a key changes.
+  volatile uint32_t last_change;
+  volatile bool     idle;
   void calibrate(uint8_t _k, uint16_t _hi, uint16_t _lo) {
     high[_k] = _hi;
     low[_k] = _lo;
@@ -48,7 +64,8 @@ protected:
 public:
   hexBoard_Key_Object(const uint8_t *arrM, const uint8_t *arrC, const bool *arrA)
   : mux(arrM), col(arrC), analog(arrA), m_ctr(0), m_val(0)
-  , active(false), send_pressure(false) {
+  , active(false), send_pressure(false), ownership(-1), calibrating(false)
+  , last_change(0), idle(false) {
     for (size_t i = 0; i < mux_pins_count; ++i) {
       pinMode(*(mux + i), OUTPUT);
       digitalWrite(*(mux + i), 0);
@@ -62,6 +79,7 @@ public:
       for (size_t j = 0; j < mux_channels_count; ++j) {
         uint8_t k = linear_index(j,i);
         pressure[k] = 0;
+        enabled[j] = UINT16_MAX;
         if (*(analog + i)) {
           calibrate(k,
             default_analog_calibration_up,
@@ -84,27 +102,100 @@ public:
     calibrate(linear_index(atMux, atCol), newHigh, newLow);
     ownership = -1;
   }
+  // a key that is held when it is masked off gets a
+  // release message on the next scan
+  void set_enabled_keys(const Key_Enable_Mask& mask) {
+    while (ownership == 1) {}
+    ownership = 0;
+    enabled = mask;
+    ownership = -1;
+  }
+  uint16_t get_high(uint8_t atMux, uint8_t atCol) { return high[linear_index(atMux, atCol)]; }
+  uint16_t get_low(uint8_t atMux, uint8_t atCol)  { return low[linear_index(atMux, atCol)];  }
+
+  // begin sampling every analog key. the player should
+  // leave keys at rest for a moment and then press
+  // each key all the way down at least once.
+  void start_calibration() {
+    while (ownership == 1) {}
+    ownership = 0;
+    cal_rest.fill(0);
+    cal_down.fill(UINT16_MAX);
+    calibrating = true;
+    ownership = -1;
+  }
+  // stop sampling and, if save_results is true, derive
+  // new thresholds for each key whose travel was large
+  // enough to trust. returns the number of keys updated.
+  size_t finish_calibration(bool save_results) {
+    size_t result = 0;
+    while (ownership == 1) {}
+    ownership = 0;
+    calibrating = false;
+    for (size_t i = 0; (i < col_pins_count) && save_results; ++i) {
+      if (!*(analog + i)) continue;
+      for (size_t j = 0; j < mux_channels_count; ++j) {
+        uint8_t k = linear_index(j,i);
+        if (cal_down[k] >= cal_rest[k]) continue;
+        uint16_t travel = cal_rest[k] - cal_down[k];
+        if (travel < min_analog_calibration_travel) continue;
+        // leave a margin at both ends so that noise
+        // at rest or at bottom-out does not register
+        uint16_t margin = travel >> analog_calibration_margin_bits;
+        calibrate(k, cal_rest[k] - margin, cal_down[k] + margin);
+        ++result;
+      }
+    }
+    for (size_t k = 0; k < keys_count; ++k) {
+      // keys may have been pressed during calibration,
+      // so force a fresh key message for every key
+      pressure[k] = UINT8_MAX;
+    }
+    ownership = -1;
+    return result;
+  }
+
+  bool is_idle() { return idle; }
+  uint32_t time_since_last_change() { return timer_hw->timerawl - last_change; }
+  // microseconds to wait until the next poll()
+  int32_t poll_interval() {
+    return (idle ? key_idle_poll_interval_uS : key_poll_interval_uS);
+  }
 
   void poll() {
     if (!active) return;
     uint8_t  index;
     uint16_t pin_read;
     uint8_t  level;
+    bool     changed = calibrating;
     while (ownership == 0) {}
     ownership = 1;
+    uint16_t allowed = (calibrating ? UINT16_MAX : enabled[m_val]);
     for (size_t i = 0; i < col_pins_count; ++i) {
       index = linear_index(m_val, i);
-      pin_read = *(analog + i) 
-               ? analogRead(*(col + i))
-               : digitalRead(*(col + i));
-      if (pin_read >= high[index]) {
+      if (!((allowed >> i) & 1)) {
+        // masked off: no read, but a key that was
+        // held when the mask came on is let go
+        if (!pressure[index]) continue;
         level = 0;
-      } else if (pin_read <= low[index]) {
-        level = 127;
-      } else if (send_pressure) {
-        level = (invert_range[index] * (high[index] - pin_read)) >> 9;
       } else {
-        level = 64;
+        pin_read = *(analog + i) 
+                 ? analogRead(*(col + i))
+                 : digitalRead(*(col + i));
+        if (calibrating) {
+          if (pin_read > cal_rest[index]) { cal_rest[index] = pin_read; }
+          if (pin_read < cal_down[index]) { cal_down[index] = pin_read; }
+          continue;
+        }
+        if (pin_read >= high[index]) {
+          level = 0;
+        } else if (pin_read <= low[index]) {
+          level = 127;
+        } else if (send_pressure) {
+          level = (invert_range[index] * (high[index] - pin_read)) >> 9;
+        } else {
+          level = 64;
+        }
       }
       if (level != pressure[index]) {
         Key_Msg key_msg_in;
@@ -113,9 +204,17 @@ public:
         key_msg_in.level = level;
         queue_add_blocking(&key_press_queue, &key_msg_in);
         pressure[index] = level;
+        changed = true;
       }
     }
     ownership = -1;
+    uint32_t right_now = timer_hw->timerawl;
+    if (changed) {
+      last_change = right_now;
+      idle = false;
+    } else if (!idle) {
+      idle = (right_now - last_change >= key_idle_timeout_uS);
+    }
     // this algorithm cycles through the multiplexer
     // by changing one bit at a time and still
     // making sure all permutations are reached
@@ -129,6 +228,7 @@ public:
   }
   
   void begin() {
+    last_change = timer_hw->timerawl;
     start();
   }
 };
\ No newline at end of file
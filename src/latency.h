@@ -0,0 +1,107 @@
+#pragma once
+/*
+ *  Key-to-sound latency instrumentation.
+ *  A key message carries the time it was scanned;
+ *  core0 notes when it comes off the queue and when
+ *  a synth voice is started, and core1 notes when
+ *  that voice renders its first sample. Each stage is
+ *  counted into a power-of-two histogram of microseconds.
+ *  The note-on itself is too quick for the microsecond
+ *  timer, so it is counted in CPU cycles off SysTick.
+ *
+ *  Every histogram has exactly one writer (stages 0, 1
+ *  and 3 are written by core0, stage 2 by core1) so no
+ *  lock is needed. The reader may see a count that is
+ *  one behind.
+ */
+#include <stdint.h>
+#include <Arduino.h>
+#include "pico/time.h"
+#include "hardware/structs/systick.h"
+
+enum {
+  _latency_scan_to_dequeue,  // key scan -> loop() removes the key message
+  _latency_dequeue_to_voice, // key message removed -> synth voice note-on
+  _latency_voice_to_sample,  // synth voice note-on -> first sample rendered
+  _latency_note_on_cycles,   // start_synth_voice(), in cycles
+  _latency_stage_count
+};
+const char* latency_stage_name[_latency_stage_count] = {
+  "scan->dequeue", "dequeue->voice", "voice->sample", "note-on"
+};
+const char* latency_stage_unit[_latency_stage_count] = {
+  "uS", "uS", "uS", "cyc"
+};
+// SysTick is a 24-bit down-counter, one per core
+const uint32_t systick_mask = 0x00FFFFFF;
+// bucket N counts times from 2^(N-1) up to 2^N - 1 units
+const uint8_t latency_bucket_count = 20;
+
+struct Latency_Histogram {
+  volatile uint32_t bucket[latency_bucket_count];
+  volatile uint32_t count;
+  volatile uint32_t max_uS;
+  volatile uint32_t total_uS;
+
+  void clear() {
+    for (auto& b : bucket) { b = 0; }
+    count = 0;
+    max_uS = 0;
+    total_uS = 0;
+  }
+  void record(uint32_t elapsed_uS) {
+    uint8_t b = (elapsed_uS ? 32 - __builtin_clz(elapsed_uS) : 0);
+    if (b >= latency_bucket_count) { b = latency_bucket_count - 1; }
+    ++bucket[b];
+    ++count;
+    total_uS += elapsed_uS;
+    if (elapsed_uS > max_uS) { max_uS = elapsed_uS; }
+  }
+};
+
+struct hexBoard_Latency_Object {
+  Latency_Histogram stage[_latency_stage_count];
+
+  hexBoard_Latency_Object() { clear(); }
+  // run on each core that records cycles
+  void begin_cycle_count() {
+    systick_hw->rvr = systick_mask;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0b101; // enable, processor clock, no interrupt
+  }
+  uint32_t cycle_count() {
+    return systick_hw->cvr;
+  }
+  void clear() {
+    for (auto& s : stage) { s.clear(); }
+  }
+  void record(uint8_t _stage, uint32_t start_time) {
+    stage[_stage].record(timer_hw->timerawl - start_time);
+  }
+  void record_cycles(uint8_t _stage, uint32_t start_count) {
+    stage[_stage].record((start_count - cycle_count()) & systick_mask);
+  }
+  // only run by primary core
+  void dump() {
+    for (uint8_t s = 0; s < _latency_stage_count; ++s) {
+      Latency_Histogram& h = stage[s];
+      Serial.print(latency_stage_name[s]);
+      Serial.print(": n=");
+      Serial.print(h.count);
+      Serial.print(" mean=");
+      Serial.print(h.count ? h.total_uS / h.count : 0);
+      Serial.print(latency_stage_unit[s]);
+      Serial.print(" max=");
+      Serial.print(h.max_uS);
+      Serial.println(latency_stage_unit[s]);
+      for (uint8_t b = 0; b < latency_bucket_count; ++b) {
+        if (!h.bucket[b]) continue;
+        Serial.print("  <");
+        Serial.print(1u << b);
+        Serial.print(latency_stage_unit[s]);
+        Serial.print(": ");
+        Serial.println(h.bucket[b]);
+      }
+    }
+  }
+};
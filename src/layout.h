@@ -8,6 +8,7 @@
  *  make sure this header occurs at the
  *  end after other declarations.
  */
+#include "MOS.h"
 
 template <typename T1, typename T2>
 void update_if_closer_to_zero(T1& LHS, const T2& RHS) {
@@ -27,11 +28,11 @@ void generate_and_apply_EDO_layout(double octave, int EDO, int A_span, int B_spa
   int spanMajor2 = 2 * spanFifth - EDO;
   int spanMinor2 = spanMajor2 - spanSharp;
   int spanMinor3 = spanFourth - spanMajor2;
-  for (auto& n : hexBoard.btn) {
+  for (auto& n : hexBoard.layout_data) {
     if (!n.isBtn) continue;
     if (!n.isNote) continue; // for now assuming cmd btns are unchanged
     n.scaleDegree = A_span * n.A_steps + B_span * n.B_steps; 
-    n.midiPitch += n.scaleDegree * (octave / 100.0 / EDO);
+    n.centsFromAnchor = n.scaleDegree * (octave / EDO);
     // scale by octave
     n.scaleEquave = 0;
     while (n.scaleDegree < 0) {
@@ -95,166 +96,13 @@ void generate_and_apply_EDO_layout(double octave, int EDO, int A_span, int B_spa
   }
 }
 
-
-// recursive formula to generate MOS scale from large/small steps
-// outputs a vector of booleans
-// large step = TRUE/1   small step = FALSE/0
-#include <vector>
-#include <map>
-
-uint gcd(const uint& _a, const uint& _b) {
-  for (uint _f = _a - 1; _f > 1; --_f) {
-    if (!((_a % _f) || (_b % _f))) {
-      return _f;
-    }
-  }
-  return 1;
-}
-
-struct MOS_Scale {
-  std::vector<bool> steps;
-  // inMode[Mode #][Lg steps][Sm steps]
-  std::vector<std::vector<std::vector<bool>>> inMode;
-  std::vector<std::vector<bool>> inMode_EDO_equiv;
-  uint Lg;
-  uint Sm;
-  uint K; // GCD
-  uint G; // bright generator
-  uint modeCt;
-  bool rational;
-  uint underlyingEDO;
-
-  float ratio_f;
-  uint ratio_num_s;
-  uint ratio_den_L;
-
-  void determine_G_and_K() {
-    K = gcd(Lg,Sm);
-    G = 0;
-    for (uint8_t m = 1; m < (Lg + Sm); ++m) {
-      if ((Sm * m) % (Lg + Sm) == 1) {
-        G = m;
-        break;
-      }
-    }
-    modeCt = (Lg + Sm) / K;
-  }
-
-  std::vector<bool> recursively_generate_MOS_scale(uint8_t L, uint8_t S) {
-    std::vector<bool> result;
-    if ((L == 1) || (S == 1)) {
-      for (uint8_t i = 0; i < L; ++i) {
-        result.emplace_back(true);
-      }
-      for (uint8_t i = 0; i < S; ++i) {
-        result.emplace_back(false);
-      }
-      return result;
-    } else {
-      int K = gcd(L,S);
-      if (K > 1) {
-        result = recursively_generate_MOS_scale(L/K, S/K);
-        std::vector<bool> repeatKtimes;
-        for (uint8_t i = 0; i < K; ++i) {
-          for (uint8_t j = 0; j < result.size(); ++j) {
-            repeatKtimes.emplace_back(result[j]);
-          }
-        }
-        return repeatKtimes;
-      } else {
-        uint8_t Mn = (L < S ? L : S);
-        uint8_t Mx = (L > S ? L : S);
-        uint8_t z = Mx % Mn;
-        uint8_t w = Mn - z;
-        uint8_t v = Mx / Mn; // floor, integer division
-        std::vector<bool> preScale = recursively_generate_MOS_scale(z, w);
-        if (L < S) {
-          std::reverse(preScale.begin(), preScale.end());
-          for (uint8_t i = 0; i < preScale.size(); ++i) {
-            result.emplace_back(true);
-            for (uint8_t j = 0; j < v + preScale[i]; ++j) {
-              result.emplace_back(false);
-            }
-          }
-        } else {
-          for (uint8_t i = 0; i < preScale.size(); ++i) {
-            for (uint8_t j = 0; j < v + preScale[i]; ++j) {
-              result.emplace_back(true);
-            }
-            result.emplace_back(false);
-          }
-        }
-      }
-    }
-    return result;
-  }
-
-  MOS_Scale(int argL, int argS) : Lg(argL), Sm(argS) {
-    determine_G_and_K();
-    steps = recursively_generate_MOS_scale(Lg,Sm);
-  }
-
-  void set_L_S_ratio(float r) {
-    rational = false;
-    ratio_f = r;
-    underlyingEDO = 0;
-  }
-
-  void set_L_S_ratio(uint n_s, uint d_l) {
-    rational = true;
-    ratio_num_s = n_s;
-    ratio_den_L = d_l;
-    ratio_f = (float)n_s / (float)d_l;
-    underlyingEDO = Sm * d_l + Lg * n_s;
-    inMode_EDO_equiv.resize(modeCt, 
-      std::vector<bool>(underlyingEDO, false));
-  }
-
-  std::vector<bool> get_mode(int mode) {
-    std::vector<bool> result;
-    for (uint8_t i = 0; i < (Lg + Sm); ++i) {
-      result.emplace_back(steps[(i + (G * mode)) % (Lg + Sm)]);
-    }
-    return result;
-  }  
-
-  void determine_key_colors() {
-    // initialize vector
-    inMode.resize(modeCt,
-      std::vector<std::vector<bool>>(Lg + 1,
-        std::vector<bool>(Sm + 1, false)
-    ));
-    int iL; // iterate # lg steps
-    int iS; // iterate # sm steps
-    for (uint8_t m = 0; m < modeCt; ++m) {
-      // traverse each mode of this scale
-      std::vector<bool> thisMode = get_mode(m);
-      iL = 0;
-      iS = 0;
-      for (uint8_t i = 0; i < Lg + Sm; ++i) {
-        // traverse each step in this mode
-        // and mark it TRUE
-        inMode[m][iL][iS] = true;
-        if (rational) {
-          inMode_EDO_equiv[m][iL * ratio_num_s + iS * ratio_den_L] = true;
-        }
-        iL +=  thisMode[i];
-        iS += !thisMode[i];
-      }
-    }
-  }
-
-};
-
-
-
 void apply_MOS_layout ( Hex    A_span, // X = lg, Y = sm
                         Hex    B_span, // X = lg, Y = sm
                         const  MOS_Scale& _mos,
                         double period, int _mode) {
   float smCents = period / _mos.Lg * _mos.ratio_f + _mos.Sm;
   float lgCents = smCents * _mos.ratio_f;
-  for (auto& n : hexBoard.btn) {
+  for (auto& n : hexBoard.layout_data) {
     if (!n.isBtn) continue;
     if (!n.isNote) continue; // for now assuming cmd btns are unchanged
     n.smallDegree = A_span.y * n.A_steps + B_span.y * n.B_steps;
@@ -276,11 +124,11 @@ void apply_MOS_layout ( Hex    A_span, // X = lg, Y = sm
         n.scaleDegree -= _mos.underlyingEDO;
       }
       n.paletteNum = -1;
-      if (_mos.inMode_EDO_equiv[_mode][n.scaleDegree]) {
+      if (_mos.in_mode_EDO_equiv(_mode, n.scaleDegree)) {
         n.paletteNum = 0; // white key
       } else {
         for (uint i = 0; i < _mos.modeCt; ++i) {
-          if (_mos.inMode_EDO_equiv[(_mode + i) % _mos.modeCt][n.scaleDegree]) {
+          if (_mos.in_mode_EDO_equiv(_mode + i, n.scaleDegree)) {
             n.paletteNum = 1;
           }
         }
@@ -298,43 +146,68 @@ void apply_MOS_layout ( Hex    A_span, // X = lg, Y = sm
       }
       n.paletteNum = -1;
       if ((n.largeDegree <= _mos.Lg) && (n.smallDegree <= _mos.Sm)) {
-        if (_mos.inMode[_mode][n.largeDegree][n.smallDegree]) {
+        if (_mos.in_mode(_mode, n.largeDegree, n.smallDegree)) {
           n.paletteNum = 0;
         } else {
           for (uint i = 0; i < _mos.modeCt; ++i) {
-            if (_mos.inMode[(_mode + i) % _mos.modeCt][n.largeDegree][n.smallDegree]) {
+            if (_mos.in_mode(_mode + i, n.largeDegree, n.smallDegree)) {
               n.paletteNum = 1;
             }
           }
         }
       }
     }
-    n.midiPitch += period * n.scaleEquave / 100.0;
-    n.midiPitch += (smCents * n.smallDegree + lgCents * n.largeDegree) / 100.0;
+    n.centsFromAnchor  = period * n.scaleEquave;
+    n.centsFromAnchor += smCents * n.smallDegree + lgCents * n.largeDegree;
+  }
+}
+
+// each key is a number of map steps from the anchor,
+// like an equal-step layout, and the keyboard map turns
+// that into a scale degree. keys the map leaves out
+// still get a pitch (as if every degree were mapped)
+// but are colored as out of scale.
+void apply_scala_layout(hexBoard_Scala_Object& _scl, int A_span, int B_span) {
+  for (auto& n : hexBoard.layout_data) {
+    if (!n.isBtn) continue;
+    if (!n.isNote) continue; // for now assuming cmd btns are unchanged
+    int32_t step = A_span * n.A_steps + B_span * n.B_steps;
+    int32_t d;
+    n.paletteNum = 0;
+    if (!_scl.step_to_degree(step, d)) {
+      d = step;
+      n.paletteNum = -1;
+    }
+    int32_t equave, within;
+    _scl.split_degree(d, equave, within);
+    n.scaleEquave = equave;
+    n.scaleDegree = within; // truncated past 127 degrees, display only
+    n.centsFromAnchor = _scl.degree_cents(d);
   }
 }
 
 #include "color.h"
 
-bool generate_layout(hexBoard_Setting_Array& refS) {
-  Hex anchorHex(refS[_anchorX].i, refS[_anchorY].i);
-  if (!hexBoard.in_bounds(anchorHex)) {
-    return false; // 1) anchor hex must be valid -- in range and not a Cmd
-  }
-  Hex hexA = unitHex[refS[_axisA].i];
-  Hex hexB = unitHex[refS[_axisB].i];
-  if ((hexA == hexB) || (hexA == hexB * -1)) {
-    return false; // 2) axes cannot be parallel
-  }
-  // express the root pitch as MIDI (note + cents/100)
-  double anchorPitch = (double)refS[_anchorN].i + refS[_anchorC].d / 100.0;  
-  double equaveCents = (refS[_equaveJI].b
-      ? intervalToCents(refS[_equaveN].d / refS[_equaveD].d)
-                      : refS[_equaveC].d);
-  if (equaveCents <= 0.0) {
-    return false; // 3) equave must be valid
-  }
-  for (auto& n : hexBoard.btn) {
+// the layout is built in stages and each stage's results
+// are cached in the grid, so that a setting change only
+// recomputes the stages it invalidates. a stage also
+// reruns everything downstream of it:
+//   steps  -> scale -> pitch -> MIDI
+//                            -> synth
+//                   -> colors -> lock
+enum {
+  _layout_stage_steps  = 1 << 0, // A and B steps from the anchor
+  _layout_stage_scale  = 1 << 1, // degree, equave, palette tier, cents from anchor
+  _layout_stage_pitch  = 1 << 2, // anchor pitch + transpose
+  _layout_stage_colors = 1 << 3, // LED codes from the palette tier
+  _layout_stage_MIDI   = 1 << 4, // MIDI note numbers, tuning table
+  _layout_stage_synth  = 1 << 5, // synth voice start records
+  _layout_stage_lock   = 1 << 6, // scale lock key mask and resting LED codes
+  _layout_stage_all    = 0x7F
+};
+
+void layout_stage_steps(const Hex& anchorHex, const Hex& hexA, const Hex& hexB) {
+  for (auto& n : hexBoard.layout_data) {
     // cache the number of A and B steps for each button
     // relative to anchor hex
     Hex h = n.coord - anchorHex;
@@ -349,9 +222,13 @@ bool generate_layout(hexBoard_Setting_Array& refS) {
       n.B_steps  = (h.y - n.A_steps * hexA.y) / 2 / hexB.y;
       n.A_steps += (h.y - n.A_steps * hexA.y) / 2 / hexA.y;
     }
-    // preload anchor pitch
-    n.midiPitch = anchorPitch;
   }    
+}
+
+void layout_stage_scale(hexBoard_Setting_Array& refS, double equaveCents) {
+  for (auto& n : hexBoard.layout_data) {
+    n.centsFromAnchor = 0.0;
+  }
   // run the next steps based on what tuning system we're in
   switch (refS[_tuneSys].i) {
     case _tuneSys_normal: {
@@ -373,66 +250,253 @@ bool generate_layout(hexBoard_Setting_Array& refS) {
       } else {
         MOS.set_L_S_ratio(refS[_lgToSmR].d);
       }
-      MOS.determine_key_colors();
       apply_MOS_layout(A_axis, B_axis, MOS, equaveCents, refS[_modeLgSm].i);
       break;
     }
+    case _tuneSys_scala: {
+      if (!scala.count) { // nothing loaded, so fall back to 12 tone
+        generate_and_apply_EDO_layout(1200.0, 12, 
+          refS[_eqStepA].i, refS[_eqStepB].i);
+        break;
+      }
+      apply_scala_layout(scala, refS[_eqStepA].i, refS[_eqStepB].i);
+      break;
+    }
     case _tuneSys_just: {
       float JIcentsA = intervalToCents((float)refS[_JInumA].i / (float)refS[_JIdenA].i);
       float JIcentsB = intervalToCents((float)refS[_JInumB].i / (float)refS[_JIdenB].i);
-      for (auto& n : hexBoard.btn) {
+      for (auto& n : hexBoard.layout_data) {
         if (!n.isBtn) continue;
         if (!n.isNote) continue; // for now assuming cmd btns are unchanged
-        n.midiPitch += JIcentsA * n.A_steps / 100.0;
-        n.midiPitch += JIcentsB * n.B_steps / 100.0;
+        n.centsFromAnchor  = JIcentsA * n.A_steps;
+        n.centsFromAnchor += JIcentsB * n.B_steps;
         n.paletteNum = 0;
       }
       break;
     }
   }
-  for (auto& n : hexBoard.btn) {
-    n.frequency = MIDItoFreq(n.midiPitch);
-    HSV paletteColor;
-    switch (n.paletteNum) {
-      case 0: {
-        paletteColor.h = 0.0;
-        paletteColor.s = 0.0;
-        paletteColor.v = 0.4;
-        break; 
-      } // white key
-      case 1: {
-        paletteColor.h = 270.0;
-        paletteColor.s = 1.0;
-        paletteColor.v = 0.2;
-        break;
-      } // black key
-      case -1: {
-        paletteColor.h = 45.0;
-        paletteColor.s = 1.0;
-        paletteColor.v = 0.2; 
-        break; 
-      } // E#/Fb
-      default: {
-        paletteColor.h = 144.0 + 36.0 * n.paletteNum;
-        paletteColor.s = 0.5;
-        paletteColor.v = 0.2;
-        break;
+  // tier 0 is the scale itself: the white keys, the
+  // chosen MOS mode, or the keys a Scala map plays
+  for (auto& n : hexBoard.layout_data) {
+    n.inScale = (n.paletteNum == 0);
+  }
+}
+
+// the root pitch expressed as MIDI (note + cents/100), after transposing
+double anchor_pitch(hexBoard_Setting_Array& refS) {
+  return (double)refS[_anchorN].i + refS[_anchorC].d / 100.0
+       + refS[_txposeS].i * refS[_txposeC].d / 100.0;
+}
+
+void layout_stage_pitch(hexBoard_Setting_Array& refS) {
+  double anchorPitch = anchor_pitch(refS);
+  for (auto& n : hexBoard.layout_data) {
+    n.pitch = MIDI_to_cents_fx(anchorPitch + n.centsFromAnchor / 100.0);
+  }
+}
+
+// for each incoming MIDI note, the key nearest its pitch
+// (within a semitone), or the key on that tuning table slot
+void layout_map_notes_to_keys(hexBoard_Setting_Array& refS) {
+  bool byTable = (refS[_MIDImode].i == _MIDImode_tuning_table);
+  for (uint8_t note = 0; note < 128; ++note) {
+    uint8_t  best = no_pixel;
+    cents_fx bestDistance = cents_fx_per_semitone;
+    for (size_t p = 0; p < keys_count; ++p) {
+      const Button_Layout_Data& n = hexBoard.layout_data[p];
+      if (!(n.isBtn && n.isNote)) continue;
+      cents_fx distance = (byTable 
+        ? (n.midiTuningTable == note ? 0 : cents_fx_per_semitone)
+        : std::abs(n.pitch - note * cents_fx_per_semitone));
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = p;
       }
     }
-    n.LEDcodeBase = okhsv_to_neopixel_code(paletteColor);
+    hexBoard.note_to_pixel[note] = best;
   }
-  // reflect transposition in frequencies
+}
 
-  // if MTS mode
-  // enumerate all the calculated pitches
-  // sort ascending, create MTS tuning table
-  // assign MIDI note based on this
+void layout_stage_MIDI(hexBoard_Setting_Array& refS) {
+  if (refS[_MIDImode].i == _MIDImode_tuning_table) {
+    mts.update(refS, hexBoard, MIDI_to_cents_fx(anchor_pitch(refS)), refS[_anchorN].i);
+    layout_map_notes_to_keys(refS);
+    return;
+  }
+  // otherwise the MIDI note is the nearest 12EDO pitch,
+  // and the bend to reach the exact pitch is cached for MPE
+  double bendPerSemitone = 8192.0 / refS[_MPEpb].i;
+  for (auto& n : hexBoard.layout_data) {
+    double midiPitch = cents_fx_to_MIDI(n.pitch);
+    long note = lround(midiPitch);
+    n.midiNote = (note < 0 ? 0 : (note > 127 ? 127 : note));
+    long bend = lround((midiPitch - n.midiNote) * bendPerSemitone);
+    n.midiBend = (bend < -8192 ? -8192 : (bend > 8191 ? 8191 : bend));
+    n.midiTuningTable = MTS_unassigned;
+  }
+  mts.invalidate();
+  layout_map_notes_to_keys(refS);
+}
 
-  // if not MTS mode
-  // MIDI note is round midiPitch
-  // calculate MPE pitch bend and store it
+// the synth note-on for a pitch, less the velocity.
+// global pitch bend is not wired up yet, so it is zero here.
+Synth_Voice_Start synth_voice_start_at(hexBoard_Setting_Array& refS, cents_fx pitch) {
+  Synth_Voice_Start s;
+  s.increment = cents_fx_to_increment(pitch_after_pitch_bend(pitch, 0 /*pb*/, 2 /*pb range*/));
+  uint32_t Hz = increment_to_Hz(s.increment);
+  s.loudness  = refS[_synthVol].i * iso226(Hz);
+  s.wavetable = (refS[_synthWav].i == _synthWav_hybrid ? hybrid_wave_bank_index(Hz) + 1 : 0);
+  return s;
+}
 
-  // note coloring, this might take a while
+void layout_stage_synth(hexBoard_Setting_Array& refS) {
+  for (auto& n : hexBoard.layout_data) {
+    n.voice_start = synth_voice_start_at(refS, n.pitch);
+  }
+}
 
+enum {
+  _palette_shade_base, // at rest
+  _palette_shade_play, // brighter, while the key sounds
+  _palette_shade_dim   // out of scale with scale lock on
+};
+uint32_t palette_color_code(int8_t paletteNum, uint8_t shade) {
+  HSV paletteColor;
+  switch (paletteNum) {
+    case 0: {
+      paletteColor.h = 0.0;
+      paletteColor.s = 0.0;
+      paletteColor.v = 0.4;
+      break; 
+    } // white key
+    case 1: {
+      paletteColor.h = 270.0;
+      paletteColor.s = 1.0;
+      paletteColor.v = 0.2;
+      break;
+    } // black key
+    case -1: {
+      paletteColor.h = 45.0;
+      paletteColor.s = 1.0;
+      paletteColor.v = 0.2; 
+      break; 
+    } // E#/Fb
+    default: {
+      paletteColor.h = 144.0 + 36.0 * paletteNum;
+      paletteColor.s = 0.5;
+      paletteColor.v = 0.2;
+      break;
+    }
+  }
+  if (shade == _palette_shade_play) {
+    paletteColor.v = 0.8;
+  } else if (shade == _palette_shade_dim) {
+    paletteColor.v *= 0.25;
+  }
+  return okhsv_to_neopixel_code(paletteColor);
+}
+
+void layout_stage_colors() {
+  // only a handful of tiers are in use at once, so
+  // run the color conversion once per tier, not per key
+  const size_t cacheSize = 16;
+  int8_t   cachedTier[cacheSize];
+  uint32_t cachedCode[cacheSize];
+  uint32_t cachedPlay[cacheSize];
+  uint32_t cachedDim[cacheSize];
+  size_t   cacheCount = 0;
+  for (size_t p = 0; p < keys_count; ++p) {
+    int8_t tier = hexBoard.layout_data[p].paletteNum;
+    size_t c = 0;
+    while ((c < cacheCount) && (cachedTier[c] != tier)) { ++c; }
+    uint32_t code;
+    uint32_t play;
+    uint32_t dim;
+    if (c < cacheCount) {
+      code = cachedCode[c];
+      play = cachedPlay[c];
+      dim  = cachedDim[c];
+    } else {
+      code = palette_color_code(tier, _palette_shade_base);
+      play = palette_color_code(tier, _palette_shade_play);
+      dim  = palette_color_code(tier, _palette_shade_dim);
+      if (cacheCount < cacheSize) {
+        cachedTier[cacheCount] = tier;
+        cachedCode[cacheCount] = code;
+        cachedPlay[cacheCount] = play;
+        cachedDim[cacheCount]  = dim;
+        ++cacheCount;
+      }
+    }
+    hexBoard.LED_codes[p].LEDcodeBase = code;
+    hexBoard.LED_codes[p].LEDcodePlay = play;
+    hexBoard.LED_codes[p].LEDcodeDim  = dim;
+  }
+}
+
+// with scale lock on, out-of-scale note keys are masked
+// off in the key scanner, so they never make a key
+// message, and rest at the dim shade.
+void layout_stage_lock(hexBoard_Setting_Array& refS) {
+  bool lock = refS[_scaleLck].b;
+  Key_Enable_Mask mask;
+  mask.fill(UINT16_MAX);
+  for (size_t p = 0; p < keys_count; ++p) {
+    const Button_Layout_Data& n = hexBoard.layout_data[p];
+    Button_LED_Codes& LED = hexBoard.LED_codes[p];
+    bool locked = lock && n.isBtn && n.isNote && !n.inScale;
+    LED.LEDcodeRest = (locked ? LED.LEDcodeDim : LED.LEDcodeBase);
+    if (locked) {
+      mask[n.atMux] &= ~(1u << n.atCol);
+    }
+  }
+  keys.set_enabled_keys(mask);
+}
+
+bool update_layout(hexBoard_Setting_Array& refS, uint8_t stages) {
+  Hex anchorHex(refS[_anchorX].i, refS[_anchorY].i);
+  if (!hexBoard.in_bounds(anchorHex)) {
+    return false; // 1) anchor hex must be valid -- in range and not a Cmd
+  }
+  Hex hexA = unitHex[refS[_axisA].i];
+  Hex hexB = unitHex[refS[_axisB].i];
+  if ((hexA == hexB) || (hexA == hexB * -1)) {
+    return false; // 2) axes cannot be parallel
+  }
+  double equaveCents = (refS[_equaveJI].b
+      ? intervalToCents(refS[_equaveN].d / refS[_equaveD].d)
+                      : refS[_equaveC].d);
+  if (equaveCents <= 0.0) {
+    return false; // 3) equave must be valid
+  }
+  if (stages & _layout_stage_steps) {
+    layout_stage_steps(anchorHex, hexA, hexB);
+    stages |= _layout_stage_scale;
+  }
+  if (stages & _layout_stage_scale) {
+    layout_stage_scale(refS, equaveCents);
+    stages |= (_layout_stage_pitch | _layout_stage_colors);
+  }
+  if (stages & _layout_stage_pitch) {
+    layout_stage_pitch(refS);
+    stages |= (_layout_stage_MIDI | _layout_stage_synth);
+  }
+  if (stages & _layout_stage_colors) {
+    layout_stage_colors();
+    stages |= _layout_stage_lock;
+  }
+  if (stages & _layout_stage_MIDI) {
+    layout_stage_MIDI(refS);
+  }
+  if (stages & _layout_stage_synth) {
+    layout_stage_synth(refS);
+  }
+  if (stages & _layout_stage_lock) {
+    layout_stage_lock(refS);
+  }
   return true;
+}
+
+bool generate_layout(hexBoard_Setting_Array& refS) {
+  return update_layout(refS, _layout_stage_all);
 }
\ No newline at end of file
@@ -3,13 +3,40 @@
 #include "GUI.h"
 #include <GEM_u8g2.h>   // library of code to create menu objects on the B&W display
 #include "config/enable-advanced-mode.h"
-GEM_u8g2 menu(u8g2);
 
 // expose the underlying numerical type linked to the menu item
 struct GEMItemPublic : public GEMItem {
   GEMItemPublic(const GEMItem& g) : GEMItem(g) {}
   byte getLinkedType() { return linkedType; }
+  GEMSelect* getSelect() { return select; } // also set for spinners
 };
+struct GEMSelectPublic : public GEMSelect {
+  int getOptionCount() { return getLength(); }
+};
+/*
+ *  expose the option being edited, so that a fast turn
+ *  of the knob can move a select or spinner several
+ *  options at once and redraw it only once. numbers
+ *  are edited digit by digit, so they are left alone.
+ */
+struct GEM_u8g2_Public : public GEM_u8g2 {
+  using GEM_u8g2::GEM_u8g2;
+  // keyCode is the key one detent would send (GEM_KEY_UP or _DOWN).
+  // returns false if the current item is not a select in edit mode.
+  bool step_edit_select(byte keyCode, int steps) {
+    if (!_editValueMode) return false;
+    GEMSelect* s = static_cast<GEMItemPublic*>(_menuPageCurrent->getCurrentMenuItem())->getSelect();
+    if (s == nullptr) return false;
+    int count = static_cast<GEMSelectPublic*>(s)->getOptionCount();
+    // the same direction that GEM gives a single key press
+    bool forward = ((keyCode == GEM_KEY_UP) == _invertKeysDuringEdit);
+    int v = _valueSelectNum + (forward ? steps : -steps);
+    _valueSelectNum = (v < 0 ? 0 : (v >= count ? count - 1 : v));
+    drawEditValueSelect();
+    return true;
+  }
+};
+GEM_u8g2_Public menu(u8g2);
 /*
  *  allow the GEMPage object to store the GUI context
  *  and make custom constructors to streamline design.
@@ -323,11 +350,11 @@ GEMSelect dropdown_palette(3, (SelectOptionInt[]){
 });
 GEMSelect dropdown_fps(4, (SelectOptionInt[]){
   {"24",24},{"30",30},{"60",60},{"70",70}});
-GEMSelect dropdown_MIDImode(4, (SelectOptionInt[]){
+// MIDI 2.0 is not offered until the USB stack has a UMP endpoint
+GEMSelect dropdown_MIDImode(3, (SelectOptionInt[]){
   {"MIDI Mode: Normal", _MIDImode_standard},
   {"MIDI Mode: MPE", _MIDImode_MPE},
-  {"MIDI Mode: MTS", _MIDImode_tuning_table},
-  {"MIDI Mode: 2.0", _MIDImode_2_point_oh}
+  {"MIDI Mode: MTS", _MIDImode_tuning_table}
 });
 GEMSelect dropdown_instruments(2, (SelectOptionInt[]){
   {"General MIDI PC:", _GM_instruments},
@@ -421,9 +448,11 @@ void showHide_generate() {
   menuItem[_smStepB]->hide(settings[_tuneSys].i != _tuneSys_lg_sm);
 
   menuItem[_eqStepA]->hide((settings[_tuneSys].i != _tuneSys_equal)
-                        && (settings[_tuneSys].i != _tuneSys_normal));
+                        && (settings[_tuneSys].i != _tuneSys_normal)
+                        && (settings[_tuneSys].i != _tuneSys_scala));
   menuItem[_eqStepB]->hide((settings[_tuneSys].i != _tuneSys_equal)
-                        && (settings[_tuneSys].i != _tuneSys_normal));
+                        && (settings[_tuneSys].i != _tuneSys_normal)
+                        && (settings[_tuneSys].i != _tuneSys_scala));
   
   menuItem[_JInumA]->hide(settings[_tuneSys].i != _tuneSys_just);
   menuItem[_JIdenA]->hide(settings[_tuneSys].i != _tuneSys_just);
@@ -444,11 +473,14 @@ void showHide_generate() {
 
 enum {
   _run_routine_to_generate_layout = -1,
+  _run_routine_to_calibrate_keys = -2,
 };
 
 extern void menu_handler(int settingNumber);
+extern void preset_handler(int slot, bool save);
 
 void onChg(GEMCallbackData callbackData) {
+  settings_saver.mark(settings, callbackData.valInt);
   switch (callbackData.valInt) {
     case _equaveJI:
       showHide_tuning();
@@ -467,10 +499,12 @@ void onChg(GEMCallbackData callbackData) {
 
 void onSelect_generate(GEMCallbackData callbackData) {
   settings[_tuneSys].i = callbackData.valInt;
+  settings_saver.mark(settings, _tuneSys);
   showHide_tuning();
   showHide_generate();
   switch (callbackData.valInt) {
     case _tuneSys_normal:
+    case _tuneSys_scala: // the tuning comes from the file
       menu.setMenuPageCurrent(pgGenerate);
       break;
     default:
@@ -481,6 +515,17 @@ void onSelect_generate(GEMCallbackData callbackData) {
   menu.drawMenu();
 }
 
+void onSelect_save_preset(GEMCallbackData callbackData) {
+  preset_handler(callbackData.valInt, true);
+  menu.setMenuPageCurrent(pgHome);
+  menu.drawMenu();
+}
+void onSelect_load_preset(GEMCallbackData callbackData) {
+  preset_handler(callbackData.valInt, false);
+  menu.setMenuPageCurrent(pgHome);
+  menu.drawMenu();
+}
+
 void create_menu_items_for_user_settings() {
   #define _CREATE_MANUAL(A, T, L)    menuItem[A] = new GEMItem(L, settings[A].T,    onChg, A)
   #define _CREATE_SELECT(A, T, L, S) menuItem[A] = new GEMItem(L, settings[A].T, S, onChg, A)
@@ -571,6 +616,7 @@ void populate_menu_structure() {
     .addMenuItem(*new GEMItem("...by equal steps",   onSelect_generate, _tuneSys_equal))
     .addMenuItem(*new GEMItem("...by lg/sm steps",   onSelect_generate, _tuneSys_lg_sm))
     .addMenuItem(*new GEMItem("...as a JI lattice",  onSelect_generate, _tuneSys_just))
+    .addMenuItem(*new GEMItem("...from Scala file",  onSelect_generate, _tuneSys_scala))
     ;
     pgTuning // first page of layout application
       .addMenuItem(*menuItem[_equaveJI]) 
@@ -627,6 +673,7 @@ void populate_menu_structure() {
     .addMenuItem(*new GEMItem("Rotary...", pgRotary))
     .addMenuItem(*new GEMItem("Command keys...", pgCommand))
     .addMenuItem(*new GEMItem("Display...", pgOLED))
+    .addMenuItem(*new GEMItem("Calibrate keys", onChg, _run_routine_to_calibrate_keys))
     ;
     pgRotary
       .addMenuItem(*menuItem[_rotInv])
@@ -652,6 +699,18 @@ void populate_menu_structure() {
     .setParentMenuPage(pgHome)
 		.addMenuItem(*menuItem[_debug])
     ;
+  pgSavePreset
+    .addMenuItem(*new GEMItem("Slot 1", onSelect_save_preset, 0))
+    .addMenuItem(*new GEMItem("Slot 2", onSelect_save_preset, 1))
+    .addMenuItem(*new GEMItem("Slot 3", onSelect_save_preset, 2))
+    .addMenuItem(*new GEMItem("Slot 4", onSelect_save_preset, 3))
+    ;
+  pgLoadPreset
+    .addMenuItem(*new GEMItem("Slot 1", onSelect_load_preset, 0))
+    .addMenuItem(*new GEMItem("Slot 2", onSelect_load_preset, 1))
+    .addMenuItem(*new GEMItem("Slot 3", onSelect_load_preset, 2))
+    .addMenuItem(*new GEMItem("Slot 4", onSelect_load_preset, 3))
+    ;
 }
 
 void query_GUI() {
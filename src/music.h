@@ -9,6 +9,89 @@
 
 using wave_tbl = std::array<int8_t, 256>;
 
+// pitch in fixed point: cents above MIDI note 0 (C-1),
+// times 2^16. the top MIDI note is 12700 cents, well inside
+// 32 bits. the note-on path works from this value with
+// integer math only, because the RP2040 has no FPU and
+// every float operation is a software library call.
+// layouts are still worked out in double and converted once.
+using cents_fx = int32_t;
+const int cents_fx_bits = 16;
+constexpr cents_fx cents_fx_per_semitone = 100 << cents_fx_bits;
+constexpr cents_fx cents_fx_per_octave = 1200 << cents_fx_bits;
+
+cents_fx MIDI_to_cents_fx(double midi) {
+  return lround(midi * cents_fx_per_semitone);
+}
+double cents_fx_to_MIDI(cents_fx c) {
+  return (double)c / cents_fx_per_semitone;
+}
+
+// 2^(i/256), i = 0 to 256, in Q30 (2^30 = 1.0), built at
+// compile time. the series is e^(x ln2), accurate for 0 <= x <= 1.
+constexpr double exp2_series(double x) {
+  double y = x * 0.6931471805599453;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 30; ++n) {
+    term *= y / n;
+    sum += term;
+  }
+  return sum;
+}
+struct Exp2_Table {
+  uint32_t v[257];
+};
+constexpr Exp2_Table build_exp2_table() {
+  Exp2_Table t = {};
+  for (int i = 0; i <= 256; ++i) {
+    t.v[i] = (uint32_t)(exp2_series(i / 256.0) * (1u << 30) + 0.5);
+  }
+  return t;
+}
+constexpr Exp2_Table exp2_Q30 = build_exp2_table();
+
+// DDS step for MIDI note 0 (8.1758 Hz), in Q8 for headroom
+constexpr double   MIDI_0_Hz = 6.875 * exp2_series(0.25); // 440 * 2^(-69/12)
+constexpr uint64_t MIDI_0_increment_Q8 = (uint64_t)(
+  MIDI_0_Hz * audio_sample_interval_uS / 1'000'000.0 * 1099511627776.0 + 0.5); // * 2^40
+// audio sample rate in Q8, to turn a step back into Hz
+constexpr uint64_t sample_rate_Hz_Q8 = (uint64_t)(
+  256'000'000.0 / audio_sample_interval_uS + 0.5);
+// cents_fx within an octave -> table position in Q16, times 2^32
+constexpr uint64_t cents_fx_to_exp2_index = (uint64_t)(
+  4294967296.0 * 256.0 / 1200.0 + 0.5);
+
+// DDS step interval for a pitch. whole octaves are a shift,
+// the rest comes from the table with linear interpolation.
+uint32_t cents_fx_to_increment(cents_fx pitch) {
+  if (pitch < 0) pitch = 0;
+  uint32_t octave = pitch / cents_fx_per_octave;
+  uint32_t within = pitch - octave * cents_fx_per_octave;
+  uint32_t index  = ((uint64_t)within * cents_fx_to_exp2_index) >> 32;
+  uint32_t i    = index >> 16;
+  uint32_t frac = index & 0xFFFF;
+  uint32_t lo = exp2_Q30.v[i];
+  uint32_t hi = exp2_Q30.v[i + 1];
+  uint32_t ratio = lo + (((uint64_t)(hi - lo) * frac) >> 16);
+  return (MIDI_0_increment_Q8 * ratio) >> (38 - octave);
+}
+
+// the whole-number frequency a DDS step plays at
+uint32_t increment_to_Hz(uint32_t increment) {
+  return ((uint64_t)increment * sample_rate_Hz_Q8) >> 40;
+}
+
+cents_fx pitch_after_pitch_bend(
+  // to apply global pitch bend to synth channels
+  cents_fx base_pitch, 
+  int16_t  global_pitch_bend, 
+  uint8_t  pitch_bend_range_in_semitones) {
+  // bend / 8192 * range * 100 cents, in Q16
+  return base_pitch 
+       + (((int32_t)global_pitch_bend * pitch_bend_range_in_semitones * 100) << (cents_fx_bits - 13));
+}
+
 // Linear waveforms such as square, saw, and triangle waves
 // can be generalized in the form A,B,C,D, as follows
 //
@@ -20,30 +103,34 @@ using wave_tbl = std::array<int8_t, 256>;
 //    ---------------------  rising from A to B has a slope of AB
 //    0     sample      255 falling from C to D has a slope of CD
 
-const float f_hyb_square   =  220.f;
-const float f_hyb_saw_low  =  440.f;
-const float f_hyb_saw_high =  880.f;
-const float f_hyb_triangle = 1760.f;
+const uint32_t f_hyb_square   =  220;
+const uint32_t f_hyb_saw_low  =  440;
+const uint32_t f_hyb_saw_high =  880;
+const uint32_t f_hyb_triangle = 1760;
 enum class Linear_Wave {square, saw, triangle, hybrid};
 
-wave_tbl linear_waveform(double _f, Linear_Wave _shp, uint8_t _mod) {
-  Linear_Wave m_shp = _shp;
-  float t_pct = 0.f;
-  if (_shp == Linear_Wave::hybrid) {
-    if (_f < f_hyb_saw_low) {
-      m_shp = Linear_Wave::square;
-      if (_f > f_hyb_square) {
-        t_pct =  (_f - f_hyb_square) / (f_hyb_saw_low - f_hyb_square);
-      }
-    } else if (_f > f_hyb_saw_high) {
-      m_shp = Linear_Wave::triangle;
-      if (_f < f_hyb_triangle) {
-        t_pct = (f_hyb_triangle - _f) / (f_hyb_triangle - f_hyb_saw_high);
-      }
-    } else {
-      m_shp = Linear_Wave::saw;
+// the hybrid wave is a square in the bass, a saw in
+// the middle and a triangle in the treble, blended in
+// between. returns the blend in 256ths (256 = 100%)
+// and sets the base shape.
+uint32_t hybrid_blend(uint32_t _f, Linear_Wave& shape) {
+  if (_f < f_hyb_saw_low) {
+    shape = Linear_Wave::square;
+    if (_f > f_hyb_square) {
+      return ((_f - f_hyb_square) << 8) / (f_hyb_saw_low - f_hyb_square);
+    }
+  } else if (_f > f_hyb_saw_high) {
+    shape = Linear_Wave::triangle;
+    if (_f < f_hyb_triangle) {
+      return ((f_hyb_triangle - _f) << 8) / (f_hyb_triangle - f_hyb_saw_high);
     }
+  } else {
+    shape = Linear_Wave::saw;
   }
+  return 0;
+}
+
+wave_tbl linear_waveform_blend(Linear_Wave m_shp, uint32_t t_pct, uint8_t _mod) {
   uint8_t d_cyc = 127 - _mod;
   uint8_t a;
   uint8_t b;
@@ -51,8 +138,8 @@ wave_tbl linear_waveform(double _f, Linear_Wave _shp, uint8_t _mod) {
   uint8_t d;  
   switch (m_shp) {
     case Linear_Wave::square: {
-      a = (d_cyc * (1.f - t_pct)) - 1;
-      b = (d_cyc * (1.f + t_pct));
+      a = ((d_cyc * (256 - t_pct)) >> 8) - 1;
+      b =  (d_cyc * (256 + t_pct)) >> 8;
       c = (d_cyc << 1) - 1;
       d = c + 1;
       break;
@@ -66,7 +153,7 @@ wave_tbl linear_waveform(double _f, Linear_Wave _shp, uint8_t _mod) {
     }
     case Linear_Wave::triangle: {
       a =  0;
-      b =  d_cyc * (2.f - t_pct);
+      b = (d_cyc * (512 - t_pct)) >> 8;
       c =  b;
       d = (d_cyc << 1);
       break;
@@ -92,6 +179,46 @@ wave_tbl linear_waveform(double _f, Linear_Wave _shp, uint8_t _mod) {
   return result;
 }
 
+// _f in Hz only matters for the hybrid wave.
+wave_tbl linear_waveform(uint32_t _f, Linear_Wave _shp, uint8_t _mod) {
+  uint32_t t_pct = 0;
+  if (_shp == Linear_Wave::hybrid) {
+    t_pct = hybrid_blend(_f, _shp);
+  }
+  return linear_waveform_blend(_shp, t_pct, _mod);
+}
+
+// rather than build a hybrid wave at every note-on, the
+// blends are built once, in steps of 1/8, and each key
+// points at the one nearest its pitch.
+const uint8_t hybrid_blend_steps = 8;
+enum {
+  _hybrid_bank_square   = 0,
+  _hybrid_bank_saw      = hybrid_blend_steps,
+  _hybrid_bank_triangle = hybrid_blend_steps + 1,
+  _hybrid_bank_size     = 2 * hybrid_blend_steps + 1
+};
+using hybrid_wave_bank = std::array<wave_tbl, _hybrid_bank_size>;
+
+void build_hybrid_wave_bank(hybrid_wave_bank& bank) {
+  for (uint8_t k = 0; k < hybrid_blend_steps; ++k) {
+    uint32_t t_pct = (k << 8) / hybrid_blend_steps;
+    bank[_hybrid_bank_square + k]   = linear_waveform_blend(Linear_Wave::square,   t_pct, 0);
+    bank[_hybrid_bank_triangle + k] = linear_waveform_blend(Linear_Wave::triangle, t_pct, 0);
+  }
+  bank[_hybrid_bank_saw] = linear_waveform_blend(Linear_Wave::saw, 0, 0);
+}
+
+uint8_t hybrid_wave_bank_index(uint32_t _f) {
+  Linear_Wave shape;
+  uint32_t step = (hybrid_blend(_f, shape) * hybrid_blend_steps) >> 8;
+  switch (shape) {
+    case Linear_Wave::square:   return _hybrid_bank_square + step;
+    case Linear_Wave::triangle: return _hybrid_bank_triangle + step;
+    default:                    return _hybrid_bank_saw;
+  }
+}
+
 // calculated ahead of time by core0 for instruments made of harmonics
 // pass arrays containing the amount of each harmonic and the phase shift.
 // amt is from 0.0 - 1.0. phase shift is in multiples of 2pi, 
@@ -134,14 +261,7 @@ const float clarinetPhase[11] = {
 };
 
 
-uint32_t frequency_to_interval(
-  // determining the DDS step interval based on frequency
-  double   frequency, 
-  uint32_t interval_in_uS) {
-  return lround(ldexp(frequency * interval_in_uS / 1000000.d, 32));
-}
-
-uint8_t iso226(double f) {
+uint8_t iso226(uint32_t f) {
   // a very crude implementation of ISO 226 equal loudness curves
   //   Hz dB  Amplitude ~ sqrt(10^(dB/10))
   //  200 +0  255
@@ -149,25 +269,15 @@ uint8_t iso226(double f) {
   // 1500 +0  255
   // 3250 -6  127
   // 5000 +0  255
-  if (f <      8.0) return 0;
-  if (f <    200.0) return 255;
-  if (f <   1500.0) return 191 + ldexp(abs(f- 800) /  700.d, 6);
-  if (f <   5000.0) return 127 + ldexp(abs(f-3250) / 1750.d, 7);
+  //   f is in whole Hz
+  if (f <      8) return 0;
+  if (f <    200) return 255;
+  if (f <   1500) return 191 + (((f > 800 ? f - 800 : 800 - f) << 6) /  700);
+  if (f <   5000) return 127 + (((f > 3250 ? f - 3250 : 3250 - f) << 7) / 1750);
   if (f < highest_MIDI_note_Hz) return 255;
   return 0;
 }
 
-double frequency_after_pitch_bend(
-  // to apply global pitch bend to synth channels
-  double  base_frequency, 
-  int16_t global_pitch_bend, 
-  uint8_t pitch_bend_range_in_semitones) {
-  return base_frequency 
-       * exp2(ldexp(global_pitch_bend 
-       * pitch_bend_range_in_semitones / 3.d, 
-        -15));
-}
-
 double freqToMIDI(double Hz) {             // formula to convert from Hz to MIDI note
   return 69.0 + 12.0 * log2(Hz / 440.0);
 }
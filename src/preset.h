@@ -0,0 +1,129 @@
+#pragma once
+/*
+ *  Layout presets.
+ *  A preset is a finished layout image: the layout
+ *  settings plus every key's layout data and LED codes,
+ *  as worked out by the layout stages. Loading one
+ *  skips the tuning math and color conversion.
+ *
+ *  Each slot is one file, read in one go into a staging
+ *  image and checked (header, struct sizes and CRC)
+ *  before it is copied into the grid, so a bad file
+ *  never leaves a half-loaded layout.
+ *
+ *  The stages that depend on settings outside the
+ *  layout (MIDI mode, synth, scale lock) are rerun
+ *  after a load.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include "LittleFS.h"
+#include "settings.h"
+#include "hexBoard.h"
+#include "debug.h"
+#include "file_system.h"
+
+const uint8_t layout_preset_slots = 4;
+const uint8_t layout_preset_header[] = {'H','X','L','P', 1, keys_count};
+constexpr size_t layout_preset_header_size = sizeof(layout_preset_header);
+
+// the settings that describe a layout: anchor,
+// axes and tuning (a contiguous run), and palette
+const uint8_t layout_preset_first_setting = _anchorX;
+const uint8_t layout_preset_last_setting  = _JIdenB;
+constexpr size_t layout_preset_setting_count = 
+  layout_preset_last_setting - layout_preset_first_setting + 2;
+
+struct Layout_Preset_Image {
+  uint8_t  header[layout_preset_header_size];
+  uint16_t layout_data_size;  // a firmware with a different
+  uint16_t LED_codes_size;    // struct layout can't use the file
+  Setting_Value settings[layout_preset_setting_count];
+  std::array<Button_Layout_Data, keys_count> layout_data;
+  std::array<Button_LED_Codes,   keys_count> LED_codes;
+  uint32_t crc;               // of everything above
+};
+// kept off the stack, about 14 kB
+Layout_Preset_Image layout_preset_staging;
+
+uint32_t layout_preset_crc(const Layout_Preset_Image& img) {
+  return crc32((const uint8_t*)&img, offsetof(Layout_Preset_Image, crc));
+}
+
+void layout_preset_file_name(char* FN, size_t len, uint8_t slot) {
+  snprintf(FN, len, "preset%u.lay", slot + 1);
+}
+
+bool save_layout_preset(hexBoard_Setting_Array& refS, 
+                        hexBoard_Grid_Object& grid, uint8_t slot) {
+  if (!fileSystemExists) return false;
+  if (slot >= layout_preset_slots) return false;
+  Layout_Preset_Image& img = layout_preset_staging;
+  memcpy(img.header, layout_preset_header, layout_preset_header_size);
+  img.layout_data_size = sizeof(Button_Layout_Data);
+  img.LED_codes_size   = sizeof(Button_LED_Codes);
+  for (size_t i = 0; i + 1 < layout_preset_setting_count; ++i) {
+    img.settings[i] = refS[layout_preset_first_setting + i];
+  }
+  img.settings[layout_preset_setting_count - 1] = refS[_palette];
+  img.layout_data = grid.layout_data;
+  img.LED_codes   = grid.LED_codes;
+  img.crc = layout_preset_crc(img);
+  // written to a temporary file which then replaces the
+  // slot, so a power cut mid-save leaves the old preset
+  char FN[16];
+  layout_preset_file_name(FN, sizeof(FN), slot);
+  char tempFN[24];
+  snprintf(tempFN, sizeof(tempFN), "%s.tmp", FN);
+  Flash_Write_Lock lock;
+  File f = LittleFS.open(tempFN, "w");
+  if (!f) {
+    debug.trace(_trace_preset_save_error);
+    return false;
+  }
+  size_t bytesWritten = f.write((const uint8_t*)&img, sizeof(img));
+  f.close();
+  if ((bytesWritten != sizeof(img)) || !LittleFS.rename(tempFN, FN)) {
+    debug.trace(_trace_preset_save_error);
+    LittleFS.remove(tempFN);
+    return false;
+  }
+  debug.trace(_trace_preset_saved);
+  return true;
+}
+
+// on success the grid and the layout settings hold the
+// preset; the caller reruns the stages that follow.
+bool load_layout_preset(hexBoard_Setting_Array& refS, 
+                        hexBoard_Grid_Object& grid, uint8_t slot) {
+  if (!fileSystemExists) return false;
+  if (slot >= layout_preset_slots) return false;
+  char FN[16];
+  layout_preset_file_name(FN, sizeof(FN), slot);
+  File f = LittleFS.open(FN, "r");
+  if (!f) {
+    debug.trace(_trace_preset_empty);
+    return false;
+  }
+  Layout_Preset_Image& img = layout_preset_staging;
+  size_t bytesRead = f.read((uint8_t*)&img, sizeof(img));
+  f.close();
+  if ((bytesRead != sizeof(img))
+   || memcmp(img.header, layout_preset_header, layout_preset_header_size)
+   || (img.layout_data_size != sizeof(Button_Layout_Data))
+   || (img.LED_codes_size   != sizeof(Button_LED_Codes))
+   || (img.crc != layout_preset_crc(img))) {
+    debug.trace(_trace_preset_invalid);
+    return false;
+  }
+  for (size_t i = 0; i + 1 < layout_preset_setting_count; ++i) {
+    refS[layout_preset_first_setting + i] = img.settings[i];
+  }
+  refS[_palette] = img.settings[layout_preset_setting_count - 1];
+  refS[_changed].b = true;
+  grid.layout_data = img.layout_data;
+  grid.LED_codes   = img.LED_codes;
+  return true;
+}
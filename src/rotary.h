@@ -2,8 +2,10 @@
 /*
  *  This is the background code that converts pinout data
  *  from the rotary knob into a queue of UI actions.
- *  This code is run on core1 in the background 
- *  and passes action messages to core0 for processing. 
+ *  This code is run on core1 from pin-change interrupts
+ *  and a slot in the core1 executive, which only checks two
+ *  deadlines, so it costs almost nothing while the knob is
+ *  idle, and passes action messages to core0 for processing. 
  *
  *  Rotary knob code derived from:
  *      https://github.com/buxtronix/arduino/tree/master/libraries/Rotary
@@ -16,6 +18,8 @@
 #include <Wire.h>
 #include "pico/util/queue.h"
 #include "pico/time.h"
+#include "hardware/sync.h"
+#include "pico/sync.h"
 #include "config.h" // import hardware config constants
 
 enum class Rotary_Action {
@@ -24,6 +28,12 @@ enum class Rotary_Action {
   click, double_click, double_click_release,
   long_press,          long_release
 };
+// turns carry a step count, which is more than one
+// when the knob is spun quickly (see acceleration below)
+struct Rotary_Msg {
+  Rotary_Action action;
+  int8_t        steps;
+};
 queue_t rotary_action_queue;
 
 struct hexBoard_Rotary_Object {
@@ -35,7 +45,7 @@ protected:
   bool _invert;                    // if A and B pins were reversed
   uint32_t _longPressThreshold;    // tolerance in microseconds; zero to ignore
   uint32_t _doubleClickThreshold;  // tolerance in microseconds; zero to ignore
-  uint32_t _debounceThreshold;     // minimum click length in microseconds
+  uint32_t _debounceThreshold;     // time the switch must be stable, in microseconds
 
 /*
  *  the A/B pins work together to measure turns.
@@ -76,14 +86,41 @@ protected:
     {5,0,6,16} //  CW  (1/0)    Retry Fail  Stall Success
   };
   uint8_t _turnState;
-  uint8_t _clickState;
+  bool    _pressed;                // debounced state of the push switch
+  uint8_t _prevTurnDirection;      // 8 = CCW, 16 = CW, as per _turnState
+  uint32_t _prevTurnTime;          // time of the last detent
+
+  // acceleration: the faster detents follow one another
+  // in the same direction, the more steps each one is worth.
+  int8_t steps_for_detent(uint8_t direction, uint32_t right_now) {
+    uint32_t elapsed = right_now - _prevTurnTime;
+    bool sameWay = (direction == _prevTurnDirection);
+    _prevTurnDirection = direction;
+    _prevTurnTime = right_now;
+    if (!sameWay) return 1;
+    for (size_t i = 0; i < rotary_accel_count; ++i) {
+      if (elapsed < rotary_accel_time_uS[i]) return rotary_accel_steps[i];
+    }
+    return 1;
+  }
 
   uint32_t _prevClickTime;
   uint32_t _prevHoldTime;
 
   bool _doubleClickRegistered;
   bool _longPressRegistered;
-  bool _debouncePassed;
+
+  // the push switch is debounced with a settle deadline:
+  // every edge pushes it back, and the switch is only read
+  // once it has been quiet for the debounce threshold.
+  // a second deadline marks when a hold becomes a long press.
+  // poll() checks both from the core1 executive. the edge
+  // interrupt can land in the middle of poll(), so the
+  // settle deadline is only read with interrupts off.
+  volatile bool     _settlePending;
+  volatile uint32_t _settleTime;
+  bool              _longPressPending;
+  uint32_t          _longPressTime;
 
   // however, GEM_Menu will set interval in milliseconds.
   void calibrate(bool setInvert, int setLP, int setDC) {
@@ -92,15 +129,61 @@ protected:
     _doubleClickThreshold = (setDC * 1000) - 1;
   }
 
-  uint8_t         ownership;
+  // the calibration is changed by core0 while core1 reads
+  // it from the pin interrupt and the executive. a critical
+  // section holds a hardware spin lock with interrupts off,
+  // so neither core, nor the interrupt, can get in between.
+  critical_section_t _lock;
+
+  void click_settled() {
+    bool pressed = (digitalRead(_Cpin) == LOW);
+    if (pressed == _pressed) return; // it bounced back
+    _pressed = pressed;
+    uint32_t right_now = timer_hw->timerawl;
+    critical_section_enter_blocking(&_lock);
+    if (pressed) {
+      _prevHoldTime = right_now;
+      if (right_now - _prevClickTime <= _doubleClickThreshold) {
+        writeAction(Rotary_Action::double_click);
+        _doubleClickRegistered = true;
+      }
+      _longPressTime = right_now + _longPressThreshold + 1;
+      _longPressPending = true;
+    } else {
+      _longPressPending = false;
+      _prevClickTime = 0;
+      if (_longPressRegistered) {
+        writeAction(Rotary_Action::long_release);
+      } else if (_doubleClickRegistered) {
+        writeAction(Rotary_Action::double_click_release);
+      } else {
+        writeAction(Rotary_Action::click);
+        _prevClickTime = _prevHoldTime;
+      }
+      _doubleClickRegistered = false;
+      _longPressRegistered = false;
+      _prevHoldTime = 0;
+    }
+    critical_section_exit(&_lock);
+  }
+
+  void long_press_elapsed() {
+    _longPressPending = false;
+    if ((!_pressed) || _longPressRegistered) return;
+    writeAction(Rotary_Action::long_press);
+    _longPressRegistered = true;
+  }
 
 public:
   hexBoard_Rotary_Object(uint8_t Apin, uint8_t Bpin, uint8_t Cpin)
   : _active(false), _Apin(Apin), _Bpin(Bpin), _Cpin(Cpin), _invert(false)
   , _longPressThreshold(-1), _doubleClickThreshold(-1)
-  , _debounceThreshold(2500) , _turnState(0), _clickState(0)
+  , _debounceThreshold(2500) , _turnState(0), _pressed(false)
+  , _prevTurnDirection(0), _prevTurnTime(0)
   , _prevClickTime(0), _prevHoldTime(0), _doubleClickRegistered(false)
-  , _longPressRegistered(false), _debouncePassed(false) {
+  , _longPressRegistered(false), _settlePending(false), _settleTime(0)
+  , _longPressPending(false), _longPressTime(0) {
+    critical_section_init(&_lock);
     pinMode(_Apin, INPUT_PULLUP);
     pinMode(_Bpin, INPUT_PULLUP);
     pinMode(_Cpin, INPUT_PULLUP);
@@ -110,77 +193,65 @@ public:
   
   // wrapper to safely calibrate knob from core0
   void recalibrate(bool invert_yn, int longPress_mS, int doubleClick_mS) {
-    while (ownership == 1) {}
-    ownership = 0;
+    critical_section_enter_blocking(&_lock);
     calibrate(invert_yn, longPress_mS, doubleClick_mS);
-    ownership = -1;
+    critical_section_exit(&_lock);
   }
 
-  void writeAction(Rotary_Action rotary_action_in) {
-    queue_add_blocking(&rotary_action_queue, &rotary_action_in);
+  // called from interrupt context, so never wait on core0
+  void writeAction(Rotary_Action rotary_action_in, int8_t steps = 1) {
+    Rotary_Msg rotary_msg_in = {rotary_action_in, steps};
+    queue_try_add(&rotary_action_queue, &rotary_msg_in);
   }
-  void poll() {
+
+  // attach to a CHANGE interrupt on pins A and B
+  void on_turn_edge() {
     if (!_active) return;
     uint8_t A = digitalRead(_Apin);
     uint8_t B = digitalRead(_Bpin);
-    while (ownership == 0) {}
-    ownership = 1;
+    critical_section_enter_blocking(&_lock);
 
     uint8_t getRotation = (_invert ? ((A << 1) | B) : ((B << 1) | A));
     _turnState = stateMatrix[_turnState & 0b00111][getRotation];
-    
-    uint8_t C = digitalRead(_Cpin);
-    _clickState = (0b00011 & ((_clickState << 1) + (C == LOW)));
 
     if ((_turnState & 0b01000) >> 3) {
-      writeAction(C ? Rotary_Action::turn_CW  : Rotary_Action::turn_CW_with_press);
+      writeAction(_pressed ? Rotary_Action::turn_CW_with_press  : Rotary_Action::turn_CW,
+        steps_for_detent(0b01000, timer_hw->timerawl));
     }
     if ((_turnState & 0b10000) >> 4) {
-      writeAction(C ? Rotary_Action::turn_CCW : Rotary_Action::turn_CCW_with_press);
+      writeAction(_pressed ? Rotary_Action::turn_CCW_with_press : Rotary_Action::turn_CCW,
+        steps_for_detent(0b10000, timer_hw->timerawl));
     }
+    critical_section_exit(&_lock);
+  }
+
+  // attach to a CHANGE interrupt on pin C
+  void on_click_edge() {
+    if (!_active) return;
+    _settleTime = timer_hw->timerawl + _debounceThreshold;
+    _settlePending = true;
+  }
+
+  // run from the core1 executive every rotary_poll_interval_uS
+  void poll() {
+    if (!_active) return;
     uint32_t right_now = timer_hw->timerawl;
-    switch (_clickState) { 
-      case 0b01: // click down
-        _prevHoldTime = right_now;
-        _debouncePassed = false;
-        break;
-      case 0b11: // held
-        if (!_debouncePassed) {
-          _debouncePassed = (right_now - _prevHoldTime >= _debounceThreshold);
-        } else if (  (!_doubleClickRegistered)
-                  && (right_now - _prevClickTime <= _doubleClickThreshold)) {
-              writeAction(Rotary_Action::double_click);            
-              _doubleClickRegistered = true;
-        } else if (  (!_longPressRegistered)
-                  && (right_now - _prevHoldTime >= _longPressThreshold)) {
-            writeAction(Rotary_Action::long_press);
-            _longPressRegistered = true;
-        }
-        break;
-      case 0b10: // click up
-        if (_debouncePassed) {
-          _prevClickTime = 0;
-          if (_longPressRegistered) {
-            writeAction(Rotary_Action::long_release);
-          } else if (_doubleClickRegistered) {
-            writeAction(Rotary_Action::double_click_release);
-          } else {
-            writeAction(Rotary_Action::click);
-            _prevClickTime = _prevHoldTime;
-          }
-          _doubleClickRegistered = false;
-          _longPressRegistered = false;
-        }
-        _prevHoldTime = 0;
-        break;
-      default:
-        break;
+    uint32_t irq = save_and_disable_interrupts();
+    bool settled = _settlePending 
+      && ((int32_t)(right_now - _settleTime) >= 0);
+    if (settled) { _settlePending = false; }
+    restore_interrupts(irq);
+    if (settled) { click_settled(); }
+    if (_longPressPending 
+     && ((int32_t)(right_now - _longPressTime) >= 0)) {
+      long_press_elapsed();
     }
-    ownership = -1;
   }
-  
+
+  // call from core1, then attach the pin-change
+  // interrupts from core1 as well so that they
+  // are serviced there.
   void begin() {
     start();
   }
 };
-
@@ -0,0 +1,237 @@
+#pragma once
+/*
+ *  Scala tuning import.
+ *  A .scl file lists the pitches of one period of a
+ *  scale, in cents or as ratios. An optional .kbm file
+ *  says which scale degree each key plays and which key
+ *  sits at a reference frequency.
+ *
+ *  Both files are read from LittleFS a chunk at a time
+ *  and parsed a line at a time, straight into a table
+ *  of fixed-point cents, so a scale of hundreds of
+ *  degrees loads without ever holding the file in RAM.
+ *
+ *  On the hexBoard the "keys" of the map are steps along
+ *  the A and B axes from the anchor hex, which plays the
+ *  map's middle note (scale degree zero).
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include "LittleFS.h"
+#include "settings.h"
+#include "music.h"
+#include "debug.h"
+#include "file_system.h"
+
+const uint16_t scala_max_degrees = 1024;
+const uint8_t  scala_max_map     = 128;
+const int16_t  scala_unmapped    = -1;
+const uint8_t  scala_line_length = 64;
+
+// hands back one line at a time from a file read in small
+// chunks. lines longer than the buffer are cut short, which
+// is harmless here: only the first word of a line is used.
+struct Scala_Line_Reader {
+  File&   f;
+  uint8_t chunk[64];
+  size_t  at  = 0;
+  size_t  len = 0;
+  char    line[scala_line_length];
+
+  Scala_Line_Reader(File& file) : f(file) {}
+
+  int next_char() {
+    if (at == len) {
+      len = f.read(chunk, sizeof(chunk));
+      at = 0;
+      if (!len) return -1;
+    }
+    return chunk[at++];
+  }
+  // the next line that is not a comment, false at the end
+  bool next() {
+    while (true) {
+      int c = next_char();
+      if (c < 0) return false;
+      size_t n = 0;
+      while ((c >= 0) && (c != '\n')) {
+        if ((c != '\r') && (n < sizeof(line) - 1)) {
+          line[n++] = c;
+        }
+        c = next_char();
+      }
+      line[n] = '\0';
+      if (line[0] != '!') return true;
+    }
+  }
+};
+
+// a pitch line is in cents if it has a period, otherwise
+// a ratio n/d or a whole number n (meaning n/1). anything
+// after the first word is a comment.
+bool scala_parse_pitch(const char* s, cents_fx& out) {
+  while ((*s == ' ') || (*s == '\t')) ++s;
+  const char* end = s;
+  while (*end && (*end != ' ') && (*end != '\t')) ++end;
+  char* stop;
+  if (memchr(s, '.', end - s)) {
+    double cents = strtod(s, &stop);
+    if (stop == s) return false;
+    out = lround(cents * (1 << cents_fx_bits));
+    return true;
+  }
+  unsigned long num = strtoul(s, &stop, 10);
+  if (stop == s) return false;
+  unsigned long den = 1;
+  if (*stop == '/') {
+    const char* d = stop + 1;
+    den = strtoul(d, &stop, 10);
+    if (stop == d) return false;
+  }
+  if (!num || !den) return false;
+  out = lround(intervalToCents((double)num / den) * (1 << cents_fx_bits));
+  return true;
+}
+
+// floor division, so negative steps land in the period below
+int32_t scala_floor_div(int32_t a, int32_t b) {
+  return (a >= 0 ? a / b : -((b - 1 - a) / b));
+}
+
+struct hexBoard_Scala_Object {
+  cents_fx degree[scala_max_degrees + 1]; // degree[0] is the unison, degree[count] the period
+  uint16_t count = 0;                     // 0 until a scale loads
+  int16_t  map[scala_max_map];            // key in the map pattern -> scale degree
+  uint8_t  map_size = 0;                  // 0 = every key plays the next degree
+  uint16_t octave_degree = 0;             // degrees per repeat of the map pattern
+  int16_t  middle_note = 60;              // key that plays degree zero
+  int16_t  reference_note = 69;           // key tuned to reference_Hz
+  double   reference_Hz = 0.0;            // 0 = keep the anchor from settings
+
+  bool load_scale(const char* FN) {
+    count = 0;
+    if (!fileSystemExists) return false;
+    File f = LittleFS.open(FN, "r");
+    if (!f) {
+      debug.trace(_trace_scala_missing);
+      return false;
+    }
+    Scala_Line_Reader r(f);
+    bool ok = r.next();              // description, not kept
+    unsigned long n = 0;
+    if (ok) {
+      ok = r.next();
+      n = strtoul(r.line, nullptr, 10);
+    }
+    ok = ok && (n >= 1) && (n <= scala_max_degrees);
+    degree[0] = 0;
+    for (size_t i = 1; ok && (i <= n); ++i) {
+      ok = r.next() && scala_parse_pitch(r.line, degree[i]);
+    }
+    f.close();
+    if (!ok || (degree[n] <= 0)) {
+      debug.trace(_trace_scala_invalid);
+      return false;
+    }
+    count = n;
+    debug.trace(_trace_scala_loaded, count);
+    return true;
+  }
+
+  void clear_keyboard_map() {
+    map_size = 0;
+    octave_degree = 0;
+    middle_note = 60;
+    reference_note = 69;
+    reference_Hz = 0.0;
+  }
+
+  // the header is seven numbers, one per line: map size,
+  // first and last note to retune (not used here), middle
+  // note, reference note, reference frequency and formal
+  // octave degree. then one line per key in the pattern,
+  // a scale degree or "x" for a key that plays nothing.
+  bool load_keyboard_map(const char* FN) {
+    clear_keyboard_map();
+    if (!fileSystemExists) return false;
+    File f = LittleFS.open(FN, "r");
+    if (!f) return false; // optional
+    Scala_Line_Reader r(f);
+    double header[7];
+    bool ok = true;
+    for (size_t i = 0; ok && (i < 7); ++i) {
+      char* stop;
+      ok = r.next();
+      header[i] = strtod(r.line, &stop);
+      ok = ok && (stop != r.line);
+    }
+    ok = ok && (header[0] >= 0) && (header[0] <= scala_max_map) && (header[5] > 0.0);
+    size_t size = (ok ? header[0] : 0);
+    for (size_t i = 0; i < size; ++i) {
+      map[i] = scala_unmapped; // missing lines are unmapped
+      if (!r.next()) continue;
+      char* stop;
+      long d = strtol(r.line, &stop, 10);
+      if ((stop != r.line) && (d >= 0)) {
+        map[i] = d;
+      }
+    }
+    f.close();
+    if (!ok) {
+      debug.trace(_trace_keyboard_map_invalid);
+      return false;
+    }
+    map_size       = size;
+    middle_note    = header[3];
+    reference_note = header[4];
+    reference_Hz   = header[5];
+    octave_degree  = header[6];
+    return true;
+  }
+
+  // degree d of the scale, any number of periods away,
+  // as whole periods plus a degree within the period
+  void split_degree(int32_t d, int32_t& equave, int32_t& within) {
+    equave = scala_floor_div(d, count);
+    within = d - equave * count;
+  }
+  double degree_cents(int32_t d) {
+    int32_t equave, within;
+    split_degree(d, equave, within);
+    return ((double)equave * degree[count] + degree[within]) / (1 << cents_fx_bits);
+  }
+
+  // steps from the middle note -> scale degree, or false
+  // if the map leaves that key unplayed
+  bool step_to_degree(int32_t step, int32_t& d) {
+    if (!map_size) {
+      d = step;
+      return true;
+    }
+    int32_t repeat = scala_floor_div(step, map_size);
+    int16_t m = map[step - repeat * map_size];
+    if (m == scala_unmapped) return false;
+    d = repeat * (octave_degree ? octave_degree : count) + m;
+    return true;
+  }
+
+  // load both files. a keyboard map with a reference
+  // frequency also moves the anchor note in settings,
+  // so the anchor hex plays the map's middle note.
+  bool load(hexBoard_Setting_Array& refS, const char* sclFN, const char* kbmFN) {
+    if (!load_scale(sclFN)) return false;
+    load_keyboard_map(kbmFN);
+    if (reference_Hz > 0.0) {
+      int32_t d;
+      if (step_to_degree(reference_note - middle_note, d)) {
+        double middle = freqToMIDI(reference_Hz) - degree_cents(d) / 100.0;
+        middle = (middle < 0.0 ? 0.0 : (middle > 127.0 ? 127.0 : middle));
+        refS[_anchorN].i = lround(middle);
+        refS[_anchorC].d = (middle - refS[_anchorN].i) * 100.0;
+      }
+    }
+    return true;
+  }
+};
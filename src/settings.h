@@ -10,6 +10,7 @@
 // if you change the list of settings,
 // make sure also to change:
 // * defaults in this file
+// * setting_ID in this file
 // * menu item creation in <menu.h>
 // * onChg handlers in <menu.h>
 // * applying settings in main
@@ -86,6 +87,82 @@ enum {
   _settingSize // the largest index plus one 
 };
 
+// stable ID of each setting in the settings file.
+// the enum above can be reordered, but these numbers
+// cannot: a new setting takes the next unused ID and
+// a retired ID is never given out again. IDs 0 thru 67
+// match the record order of the old headerless file.
+const uint8_t setting_ID[_settingSize] = {
+  0,         // _defaults
+  1,         // _changed
+  2,         // _debug
+  3,         // _anchorX
+  4,         // _anchorY
+  5,         // _anchorN
+  6,         // _anchorC
+  7,         // _txposeS
+  8,         // _txposeC
+  9,         // _axisA
+  10,        // _axisB
+  11,        // _equaveJI
+  12,        // _equaveC
+  13,        // _equaveN
+  14,        // _equaveD
+  15,        // _tuneSys
+  16,        // _eqDivs
+  17,        // _eqStepA
+  18,        // _eqStepB
+  19,        // _lgSteps
+  20,        // _smSteps
+  21,        // _lgStepA
+  22,        // _smStepA
+  23,        // _lgStepB
+  24,        // _smStepB
+  25,        // _lgToSmND
+  26,        // _lgToSmR
+  27,        // _lgToSmN
+  28,        // _lgToSmD
+  29,        // _modeLgSm
+  30,        // _JInumA
+  31,        // _JIdenA
+  32,        // _JInumB
+  33,        // _JIdenB
+  34,        // _scaleLck
+  35,        // _animFPS
+  36,        // _palette
+  37,        // _animType
+  38,        // _globlBrt
+  39,        // _hueLoop
+  40,        // _tglWheel
+  41,        // _whlMode
+  42,        // _mdSticky
+  43,        // _pbSticky
+  44,        // _vlSticky
+  45,        // _mdSpeed
+  46,        // _pbSpeed
+  47,        // _vlSpeed
+  48,        // _rotInv
+  49,        // _rotDblCk
+  50,        // _rotLongP
+  51,        // _SStime
+  52,        // _MIDImode
+  53,        // _MIDIusb
+  54,        // _MIDIjack
+  55,        // _MPEzoneC
+  56,        // _MPEzoneL
+  57,        // _MPEzoneR
+  58,        // _MPEpb
+  59,        // _MIDIorMT
+  60,        // _MIDIpc
+  61,        // _MT32pc
+  62,        // _synthTyp
+  63,        // _synthWav
+  64,        // _synthEnv
+  65,        // _synthVol
+  66,        // _synthBuz
+  67,        // _synthJac
+};
+
 // use regular enum, not enum class, to identify options.
 // we need to be able to cast these to integers
 // for the menu system to work.
@@ -93,7 +170,8 @@ enum {
   _tuneSys_normal,
   _tuneSys_equal,
   _tuneSys_lg_sm,
-  _tuneSys_just
+  _tuneSys_just,
+  _tuneSys_scala
 };
 enum {
   _palette_rainbow,
@@ -124,7 +202,7 @@ enum {
   _MIDImode_standard,
   _MIDImode_MPE,
   _MIDImode_tuning_table,
-  _MIDImode_2_point_oh
+  _MIDImode_2_point_oh   // reserved, not implemented: needs a UMP endpoint
 };
 enum {
   _synthTyp_off,
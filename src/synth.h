@@ -19,69 +19,86 @@
 #include "pico/util/queue.h"
 #include "pico/time.h"
 #include "config.h" // import hardware config constants
+#include "latency.h"
 
 enum class ADSR_Phase {
   off, attack, decay, sustain, release
 };
 
+// envelope shape, worked out when the setting changes
+// and copied into each voice as it starts.
+struct Synth_Envelope {
+  uint32_t attack;  // express in # of samples
+  uint32_t decay;   // express in # of samples
+  uint8_t  sustain; // express from 0-255
+  uint32_t release; // express in # of samples
+  uint32_t attack_inverse;
+  uint32_t decay_inverse;
+  uint32_t release_inverse;
+
+  void set(uint32_t a, uint32_t d, uint8_t s, uint32_t r) {
+    attack = a * 1000 / audio_sample_interval_uS;
+    decay = d * 1000 / audio_sample_interval_uS;
+    sustain = s;
+    release = r * 1000 / audio_sample_interval_uS;
+    attack_inverse  = !attack ? 0 : 0xFFFFFFFF / attack;
+    decay_inverse   = !decay ? 0 : ((256 - sustain) << 24) / decay;
+    release_inverse = !release ? 0 : (sustain << 24) / release;
+  }
+};
+
+// everything a key needs to start a voice except the
+// velocity, worked out when the layout or synth settings
+// change so that note-on is a few stores.
+struct Synth_Voice_Start {
+  uint32_t increment = 0; // DDS step for the key's pitch
+  uint16_t loudness  = 0; // volume setting times ISO 226 weight
+  uint8_t  wavetable = 0; // 0 = cached waveform, else hybrid bank entry + 1
+};
+
 struct Synth_Voice {
-  int8_t wavetable[256];
+  const int8_t* wavetable; // points into the grid's tables, never copied
   uint32_t pitch_as_increment;
   uint8_t base_volume;
-  uint32_t attack; // express in # of samples
-  uint32_t decay;  // express in # of samples
-  uint8_t sustain; // express from 0-255
-  uint32_t release; // express in # of samples
+  Synth_Envelope envelope;
 
   uint32_t loop_counter;
   int32_t envelope_counter; // used to apply envelope
   uint8_t envelope_level; // stored to ensure even fade at release
   ADSR_Phase phase;  
-  uint32_t attack_inverse;
-  uint32_t decay_inverse;
-  uint32_t release_inverse;
   uint8_t  ownership;
+  uint32_t note_on_time;          // for latency measurement
+  bool     first_sample_pending;  // for latency measurement
 
   // define a series of setter functions for core0
   // which will block if core1 is trying to calculate
   // the next sample.
-  void update_wavetable(const std::array<int8_t,256>& tbl) {
-    while (ownership == 1) {}
-    ownership = 0;
-    for (size_t i = 0; i <  256; ++i) {
-      wavetable[i] = tbl[i];
-    }
-    ownership = -1;
-  }
   void update_pitch(uint32_t increment) {
     while (ownership == 1) {}
     ownership = 0;
     pitch_as_increment = increment;
     ownership = -1;
   }
-  void update_base_volume(uint8_t volume) {
-    while (ownership == 1) {}
-    ownership = 0;
-    base_volume = volume;
-    ownership = -1;
-  }
-  void update_envelope(uint32_t a, uint32_t d, uint8_t s, uint32_t r) {
+  void update_wavetable(const int8_t* table) {
     while (ownership == 1) {}
     ownership = 0;
-    attack = a * 1000 / audio_sample_interval_uS;
-    decay = d * 1000 / audio_sample_interval_uS;
-    sustain = s;
-    release = r * 1000 / audio_sample_interval_uS;
-    attack_inverse  = !attack ? 0 : 0xFFFFFFFF / attack;
-    decay_inverse   = !decay ? 0 : ((256 - sustain) << 24) / decay;
-    release_inverse = !release ? 0 : (sustain << 24) / release;
+    wavetable = table;
     ownership = -1;
   }
-  void note_on() {
+  // everything for a new note is set in one go,
+  // so core1 waits on the voice once, not four times.
+  void note_on(const int8_t* table, uint32_t increment, 
+               uint8_t volume, const Synth_Envelope& env) {
     while (ownership == 1) {}
     ownership = 0;
+    wavetable = table;
+    pitch_as_increment = increment;
+    base_volume = volume;
+    envelope = env;
     envelope_counter = 0;
     phase = ADSR_Phase::attack;
+    note_on_time = timer_hw->timerawl;
+    first_sample_pending = true;
     ownership = -1;
   }
   void note_off() {
@@ -89,9 +106,10 @@ struct Synth_Voice {
     ownership = 0;
     phase = ADSR_Phase::release;
     envelope_counter = 0;
-    if (envelope_level != sustain) {
-       envelope_counter = round((1.f - ((float)envelope_level / sustain)) * release);
+    if (envelope_level != envelope.sustain) {
+       envelope_counter = round((1.f - ((float)envelope_level / envelope.sustain)) * envelope.release);
     }
+    ownership = -1;
   }
   // called from core 1 only
   int32_t next_sample() {
@@ -99,37 +117,41 @@ struct Synth_Voice {
     ownership = 1;
     loop_counter += pitch_as_increment;
     int8_t sample = wavetable[loop_counter >> 24];
+    if (first_sample_pending) {
+      latency.record(_latency_voice_to_sample, note_on_time);
+      first_sample_pending = false;
+    }
     switch (phase) {
       case ADSR_Phase::attack:
-        if (envelope_counter == attack) {
+        if (envelope_counter == envelope.attack) {
           phase = ADSR_Phase::decay;
           envelope_counter = 0;
           envelope_level = 255;
         } else {
           ++envelope_counter;
-          envelope_level = (envelope_counter * attack_inverse) >> 24; 
+          envelope_level = (envelope_counter * envelope.attack_inverse) >> 24; 
         }
         break;
       case ADSR_Phase::decay:
-        if (envelope_counter >= decay) {
+        if (envelope_counter >= envelope.decay) {
           phase = ADSR_Phase::sustain;
           envelope_counter = 0;
-          envelope_level = sustain;
+          envelope_level = envelope.sustain;
         } else {
           ++envelope_counter;
-          envelope_level = 255 - ((envelope_counter * decay_inverse) >> 24); 
+          envelope_level = 255 - ((envelope_counter * envelope.decay_inverse) >> 24); 
         }
         break;
       case ADSR_Phase::sustain: 
-        envelope_level = sustain;
+        envelope_level = envelope.sustain;
         break;
       case ADSR_Phase::release:
-        if (envelope_counter == release) {
+        if (envelope_counter == envelope.release) {
           phase = ADSR_Phase::off;
           envelope_level = 0;
         } else {
           ++envelope_counter;
-          envelope_level = sustain - ((envelope_counter * release_inverse) >> 24); 
+          envelope_level = envelope.sustain - ((envelope_counter * envelope.release_inverse) >> 24); 
         }
     }
     ownership = -1;
@@ -149,6 +171,7 @@ struct hexBoard_Synth_Object {
   pwm_config cfg;
   uint8_t ownership;
   uint16_t baseline_level;
+  Synth_Envelope envelope; // copied into each voice at note-on
 
   void internal_set_pin(uint8_t pin, bool activate) {
     auto n = std::find(pins.begin(), pins.end(), pin);
@@ -167,6 +190,20 @@ struct hexBoard_Synth_Object {
   }
   void start() {active = true;}
   void stop() {active = false;}
+  bool is_silent() {
+    for (auto& v : voice) {
+      if (v.phase != ADSR_Phase::off) return false;
+    }
+    return true;
+  }
+
+  // move every voice playing from_table over to to_table,
+  // so that from_table can be rewritten safely afterwards
+  void retarget_wavetable(const int8_t* from_table, const int8_t* to_table) {
+    for (auto& v : voice) {
+      if (v.wavetable == from_table) v.update_wavetable(to_table);
+    }
+  }
 
   void set_pin(uint8_t pin, bool activate) {
     while (ownership == 1) {}
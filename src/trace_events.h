@@ -0,0 +1,90 @@
+#pragma once
+/*
+ *  Trace events.
+ *  The list of events the debug trace can log, and the
+ *  printf format that turns each one back into text.
+ *  The board sends records as numbers; the decoder in
+ *  tools/ includes this file to print them, so it must
+ *  not depend on the Arduino core.
+ *
+ *  Add new events at the end, before _trace_event_count,
+ *  so that logs taken with older firmware still decode.
+ */
+
+enum {
+  _trace_none,
+  _trace_USB_mounted,
+  _trace_fs_reformat,
+  _trace_fs_format_failed,
+  _trace_settings_missing,
+  _trace_settings_invalid,
+  _trace_settings_migrated,
+  _trace_settings_damaged,
+  _trace_settings_loaded,
+  _trace_settings_save_error,
+  _trace_settings_saved,
+  _trace_calibration_missing,
+  _trace_calibration_invalid,
+  _trace_calibration_loaded,
+  _trace_calibration_save_error,
+  _trace_calibration_saved,
+  _trace_calibrated,
+  _trace_preset_save_error,
+  _trace_preset_saved,
+  _trace_preset_empty,
+  _trace_preset_invalid,
+  _trace_preset_loaded,
+  _trace_scala_missing,
+  _trace_scala_invalid,
+  _trace_scala_loaded,
+  _trace_keyboard_map_invalid,
+  _trace_synth_no_voice,
+  _trace_synth_queue_full,
+  _trace_note_pitch,
+  _trace_note_steps,
+  _trace_note_degree,
+  _trace_note_MOS,
+  _trace_event_count
+};
+// printf formats for the decoder, given both numbers
+const char* trace_event_format[_trace_event_count] = {
+  "",
+  "it took %d uS to mount TinyUSB.",
+  "LittleFS could not mount; re-formatting storage space.",
+  "That's odd, there was even a problem re-formatting.",
+  "Settings file did not exist.",
+  "Settings file is not valid, using defaults.",
+  "Settings migrated from the old file format.",
+  "Settings file is damaged, using defaults.",
+  "Settings loaded from file.",
+  "An Error has occurred while saving settings",
+  "settings saved in %d uS",
+  "Key calibration file did not exist.",
+  "Key calibration file is not valid, using defaults.",
+  "Key calibration loaded from file.",
+  "An Error has occurred while saving key calibration",
+  "key calibration saved",
+  "calibrated %d keys",
+  "An Error has occurred while saving the preset",
+  "preset saved",
+  "Preset slot is empty.",
+  "Preset file is not valid.",
+  "preset loaded in %d uS",
+  "Scala file did not exist.",
+  "Scala file is not valid.",
+  "Scala file loaded, %d degrees",
+  "Keyboard map is not valid, using every degree in order.",
+  "emptyyyy",
+  "negative ghost rider the channels full",
+  "note %d tier %d",
+  "  A %d B %d",
+  "  octave %d step %d",
+  "  / %dL,%ds"
+};
+
+// how the board sends each record and each count of
+// lost records, one per line:
+//   @T <timestamp> <core> <event> <arg0> <arg1>
+//   @D <core> <records dropped>
+#define TRACE_RECORD_PREFIX  "@T"
+#define TRACE_DROPPED_PREFIX "@D"
@@ -0,0 +1,44 @@
+#pragma once
+// times a piece of code on the host, best of several runs
+#include <chrono>
+#include <cstdio>
+
+template <typename F>
+double best_ns(int runs, int reps, F f) {
+  double best = 1e30;
+  for (int r = 0; r < runs; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) f();
+    auto stop = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count() / reps;
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+// keeps the compiler from throwing away a result
+inline volatile uint32_t bench_sink;
+
+// the CPU's own cycle counter where there is one to read.
+// TSC ticks at a fixed rate, close to the base clock.
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint64_t bench_cycles() { return __rdtsc(); }
+#define BENCH_HAS_CYCLES 1
+#else
+inline uint64_t bench_cycles() { return 0; }
+#define BENCH_HAS_CYCLES 0
+#endif
+
+// fewest cycles for one call of f, best of several runs of reps calls
+template <typename F>
+double best_cycles(int runs, int reps, F f) {
+  double best = 1e30;
+  for (int r = 0; r < runs; ++r) {
+    uint64_t start = bench_cycles();
+    for (int i = 0; i < reps; ++i) f(i);
+    double c = double(bench_cycles() - start) / reps;
+    if (c < best) best = c;
+  }
+  return best;
+}
@@ -0,0 +1,23 @@
+#pragma once
+// the smallest test harness that will do: CHECK counts
+// and prints failures, and main returns finish() so the
+// Makefile stops on the first test program that fails.
+#include <cstdio>
+
+inline int check_failures = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    ++check_failures; \
+    printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+  } \
+} while (0)
+
+inline int finish(const char* name) {
+  if (check_failures) {
+    printf("%s: %d failed\n", name, check_failures);
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}
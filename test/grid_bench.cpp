@@ -0,0 +1,156 @@
+// the grid as three arrays (hexBoard.h) against the old
+// single ~90 byte Button struct, in the three loops that
+// walk every key: the LED frame, the OLED heads-up
+// display, and a layout pass. the loop bodies are the
+// same on both sides; only the data layout differs.
+//
+// this runs on the host, whose caches hold the whole
+// grid either way, so it shows the cost of striding past
+// the cold fields rather than of cache misses. the RP2040
+// has no data cache, only the XIP cache for flash.
+#include "bench.h"
+#include "../src/latency.h"
+hexBoard_Latency_Object latency;
+#include "../src/hexBoard.h"
+
+void hardwired_switch_handler(int16_t) {}
+
+// the Button struct before the split, fields as they were
+struct Old_Button {
+  bool      isUsed = false;
+  int8_t    atMux  = -1;
+  int8_t    atCol  = -1;
+  bool      isBtn  = false;
+  Hex       coord  = {0,0};
+  int16_t   pixel  = -1;
+  bool      isNote = false;
+  bool      isCmd  = false;
+  int8_t    A_steps = 0;
+  int8_t    B_steps = 0;
+  bool      inScale = false;
+  int8_t    scaleEquave = 0;
+  int8_t    scaleDegree = 0;
+  int8_t    smallDegree = 0;
+  int8_t    largeDegree = 0;
+  uint8_t   midiCh = 0;
+  uint8_t   midiTuningTable = 255;
+  double    midiPitch = 0.0;
+  double    frequency = 0.0;
+  uint8_t   cmd = 0;
+  int8_t    paletteNum = 0;
+  uint32_t  LEDcodeBase = 0;
+  uint32_t  LEDcodeAnim = 0;
+  uint32_t  LEDcodePlay = 0;
+  uint32_t  LEDcodeRest = 0;
+  uint32_t  LEDcodeOff  = 0;
+  uint32_t  LEDcodeDim  = 0;
+  uint32_t  timeLastUpdate = 0;
+  uint32_t  timePressBegan = 0;
+  uint32_t  timeHeldSince  = 0;
+  uint8_t   pressure       = 0;
+  uint8_t   velocity       = 0;
+  bool      just_pressed   = false;
+  bool      just_released  = false;
+  uint8_t   midiChPlaying  = 0;
+  uint8_t   midiNote = 0;
+  int16_t   midiBend = 0;
+  uint8_t   synthChPlaying = 0;
+};
+
+hexBoard_Grid_Object grid(hexBoard_layout_v1_2, hexBoard_lookup_v1_2);
+std::array<Old_Button, keys_count> old_grid;
+uint32_t strip[keys_count];
+uint32_t pixels_drawn;
+
+inline void draw_pixel(int x, int y) { pixels_drawn += x ^ y; }
+
+// the same heads-up display body as GUI.h
+#define HUD_BODY(b, pressure) \
+  if (!b.isBtn) continue; \
+  int atX = 40 + 2 * b.coord.x - (b.coord.x <= -10 ? 1 : 0); \
+  int atY = 60 + 3 * b.coord.y; \
+  draw_pixel(atX, atY); \
+  if (pressure) { \
+    draw_pixel(atX, atY - 1); \
+    draw_pixel(atX, atY + 1); \
+    if (pressure > 64) { draw_pixel(atX - 1, atY); draw_pixel(atX + 1, atY); } \
+  }
+
+// a layout pass: steps from the anchor to degrees and tiers
+#define LAYOUT_BODY(n) \
+  if (!n.isBtn || !n.isNote) continue; \
+  n.smallDegree = 2 * n.A_steps + n.B_steps; \
+  n.largeDegree = n.A_steps - 3 * n.B_steps; \
+  n.scaleDegree = (n.smallDegree + n.largeDegree) & 7; \
+  n.paletteNum  = (n.scaleDegree & 1 ? 1 : 0);
+
+int main() {
+  // the same keys, steps and colors on both sides
+  for (size_t p = 0; p < keys_count; ++p) {
+    Button b = grid.button_at_pixel(p);
+    b.layout.A_steps = b.layout.coord.x;
+    b.layout.B_steps = b.layout.coord.y;
+    b.LED.LEDcodePlay = 0xFF0000 + p;
+    b.LED.LEDcodeRest = 0x00FF00 + p;
+    b.play.pressure = (p % 7 == 0 ? 100 : 0);
+    b.play.externalNotes = (p % 11 == 0);
+    Old_Button& o = old_grid[p];
+    o.isBtn = b.layout.isBtn;
+    o.isNote = b.layout.isNote;
+    o.coord = b.layout.coord;
+    o.A_steps = b.layout.A_steps;
+    o.B_steps = b.layout.B_steps;
+    o.LEDcodePlay = b.LED.LEDcodePlay;
+    o.LEDcodeRest = b.LED.LEDcodeRest;
+    o.pressure = b.play.pressure;
+    o.midiChPlaying = b.play.externalNotes; // stands in for externalNotes
+  }
+
+  const int reps = 20000;
+  double old_LED = best_ns(7, reps, [] {
+    for (size_t p = 0; p < keys_count; ++p) {
+      const Old_Button& b = old_grid[p];
+      strip[p] = (b.midiChPlaying ? b.LEDcodePlay : b.LEDcodeRest);
+    }
+    bench_sink = strip[keys_count - 1];
+  });
+  double new_LED = best_ns(7, reps, [] {
+    for (size_t p = 0; p < keys_count; ++p) {
+      strip[p] = (grid.play_state[p].externalNotes
+        ? grid.LED_codes[p].LEDcodePlay
+        : grid.LED_codes[p].LEDcodeRest);
+    }
+    bench_sink = strip[keys_count - 1];
+  });
+  double old_HUD = best_ns(7, reps, [] {
+    for (size_t p = 0; p < keys_count; ++p) {
+      const Old_Button& b = old_grid[p];
+      HUD_BODY(b, b.pressure)
+    }
+    bench_sink = pixels_drawn;
+  });
+  double new_HUD = best_ns(7, reps, [] {
+    for (size_t p = 0; p < keys_count; ++p) {
+      const Button_Layout_Data& b = grid.layout_data[p];
+      uint8_t pressure = grid.play_state[p].pressure;
+      HUD_BODY(b, pressure)
+    }
+    bench_sink = pixels_drawn;
+  });
+  double old_layout = best_ns(7, reps, [] {
+    for (auto& n : old_grid) { LAYOUT_BODY(n) }
+    bench_sink = old_grid[5].paletteNum;
+  });
+  double new_layout = best_ns(7, reps, [] {
+    for (auto& n : grid.layout_data) { LAYOUT_BODY(n) }
+    bench_sink = grid.layout_data[5].paletteNum;
+  });
+
+  printf("grid_bench: %zu keys, old Button %zu bytes; now layout %zu, play %zu, LED %zu\n",
+    keys_count, sizeof(Old_Button), sizeof(Button_Layout_Data),
+    sizeof(Button_Play_State), sizeof(Button_LED_Codes));
+  printf("  LED frame:  old %7.0f ns, new %7.0f ns, %.1fx\n", old_LED, new_LED, old_LED / new_LED);
+  printf("  HUD:        old %7.0f ns, new %7.0f ns, %.1fx\n", old_HUD, new_HUD, old_HUD / new_HUD);
+  printf("  layout:     old %7.0f ns, new %7.0f ns, %.1fx\n", old_layout, new_layout, old_layout / new_layout);
+  return 0;
+}
@@ -0,0 +1,90 @@
+// the key-to-sound latency harness run on the host: a key
+// scanned by the real scanner, its message taken off the
+// real queue, a real synth voice started and rendered,
+// with the clock moved by hand between the stages. checks
+// that each stage lands in its own histogram, in the
+// right bucket, across a timer wrap, and that the serial
+// report reads back what was recorded.
+#include "check.h"
+#include "../src/latency.h"
+hexBoard_Latency_Object latency;
+#include "../src/keys.h"
+#include "../src/synth.h"
+
+hexBoard_Key_Object keys(muxPins, colPins, analogPins);
+int8_t wave[256];
+
+// one key press through every stage; returns how many key
+// messages the scan made
+int press_and_play(Synth_Voice& voice, uint32_t scan_at, uint32_t to_dequeue,
+                   uint32_t to_voice, uint32_t to_sample) {
+  host_timer.timerawl = scan_at;
+  host_pin_level = LOW; // every key on the next mux channel goes down
+  keys.poll();
+  int messages = 0;
+  Key_Msg msg;
+  host_timer.timerawl += to_dequeue;
+  uint32_t dequeue_time = timer_hw->timerawl;
+  while (queue_try_remove(&key_press_queue, &msg)) {
+    ++messages;
+    latency.record(_latency_scan_to_dequeue, msg.timestamp);
+  }
+  // one voice is enough
+  host_timer.timerawl += to_voice;
+  voice.note_on(wave, 1u << 24, 100, Synth_Envelope());
+  latency.record(_latency_dequeue_to_voice, dequeue_time);
+  host_timer.timerawl += to_sample;
+  voice.next_sample();
+  voice.next_sample(); // only the first sample counts
+  return messages;
+}
+
+int main() {
+  queue_init(&key_press_queue, sizeof(Key_Msg), keys_count);
+  keys.begin();
+  Synth_Voice voice = {};
+  voice.ownership = -1;
+  voice.wavetable = wave;
+
+  int messages = press_and_play(voice, 1000, 30, 5, 40);
+  // one mux channel: a message for each column
+  CHECK(messages == col_pins_count);
+  Latency_Histogram& scan   = latency.stage[_latency_scan_to_dequeue];
+  Latency_Histogram& toVoice = latency.stage[_latency_dequeue_to_voice];
+  Latency_Histogram& sample = latency.stage[_latency_voice_to_sample];
+  CHECK(scan.count == col_pins_count);
+  CHECK(scan.max_uS == 30);
+  CHECK(scan.bucket[5] == col_pins_count);   // 16 to 31
+  CHECK(toVoice.count == 1);
+  CHECK(toVoice.max_uS == 5);
+  CHECK(toVoice.bucket[3] == 1);             // 4 to 7
+  CHECK(sample.count == 1);
+  CHECK(sample.max_uS == 40);
+  CHECK(sample.bucket[6] == 1);              // 32 to 63
+
+  // across the 32-bit timer wrapping, and a long wait
+  // that lands in the last bucket
+  press_and_play(voice, 0xFFFFFFF0u, 32, 0, 2'000'000);
+  CHECK(scan.max_uS == 32);
+  CHECK(scan.bucket[6] == col_pins_count);
+  CHECK(toVoice.bucket[0] == 1);
+  CHECK(sample.max_uS == 2'000'000);
+  CHECK(sample.bucket[latency_bucket_count - 1] == 1);
+  CHECK(sample.total_uS == 2'000'040);
+
+  // note-on cycles come off the 24-bit SysTick, counting down
+  host_systick.cvr = 0x000010;
+  uint32_t start_count = latency.cycle_count();
+  host_systick.cvr = 0xFFFFF0; // wrapped
+  latency.record_cycles(_latency_note_on_cycles, start_count);
+  CHECK(latency.stage[_latency_note_on_cycles].max_uS == 0x20);
+
+  Serial.out.clear();
+  latency.dump();
+  CHECK(Serial.out.find("scan->dequeue: n=20 mean=31uS max=32uS\n  <32uS: 10\n  <64uS: 10\n") == 0);
+  CHECK(Serial.out.find("note-on: n=1 mean=32cyc max=32cyc\n  <64cyc: 1\n") != std::string::npos);
+
+  latency.clear();
+  for (auto& h : latency.stage) CHECK(h.count == 0 && h.max_uS == 0);
+  return finish("latency_test");
+}
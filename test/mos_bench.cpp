@@ -0,0 +1,64 @@
+// src/MOS.h against the old recursive generator, over
+// every scale with 1 <= Lg, Sm and Lg + Sm <= 64: building
+// the step word, and building it then coloring a layout
+// (the old code filled an inMode table first; the new code
+// answers each question from the word instead)
+#include "bench.h"
+#include "../src/MOS.h"
+#include "mos_reference.h"
+
+int main() {
+  double old_build = best_ns(5, 1, [] {
+    for (uint Lg = 1; Lg < 64; ++Lg)
+      for (uint Sm = 1; Lg + Sm <= 64; ++Sm) {
+        Reference_MOS_Scale ref(Lg, Sm);
+        bench_sink = ref.steps.size();
+      }
+  });
+  double new_build = best_ns(5, 1, [] {
+    for (uint Lg = 1; Lg < 64; ++Lg)
+      for (uint Sm = 1; Lg + Sm <= 64; ++Sm) {
+        MOS_Scale mos(Lg, Sm);
+        bench_sink = mos.steps[0];
+      }
+  });
+  // what apply_MOS_layout asks: for each of 140 keys, is it
+  // in the chosen mode, and if not, in any mode. the keys
+  // sit at every (lg, sm) in turn within one period.
+  double old_keys = best_ns(3, 1, [] {
+    for (uint Lg = 1; Lg < 64; ++Lg)
+      for (uint Sm = 1; Lg + Sm <= 64; ++Sm) {
+        Reference_MOS_Scale ref(Lg, Sm);
+        ref.rational = false;
+        ref.determine_key_colors();
+        uint found = 0;
+        for (uint k = 0; k < 140; ++k) {
+          uint lg = k % (Lg + 1);
+          uint sm = (k / (Lg + 1)) % (Sm + 1);
+          if (ref.inMode[0][lg][sm]) { ++found; continue; }
+          for (uint m = 0; m < ref.modeCt; ++m) found += ref.inMode[m][lg][sm];
+        }
+        bench_sink = found;
+      }
+  });
+  double new_keys = best_ns(3, 1, [] {
+    for (uint Lg = 1; Lg < 64; ++Lg)
+      for (uint Sm = 1; Lg + Sm <= 64; ++Sm) {
+        MOS_Scale mos(Lg, Sm);
+        uint found = 0;
+        for (uint k = 0; k < 140; ++k) {
+          uint lg = k % (Lg + 1);
+          uint sm = (k / (Lg + 1)) % (Sm + 1);
+          if (mos.in_mode(0, lg, sm)) { ++found; continue; }
+          for (uint m = 0; m < mos.modeCt; ++m) found += mos.in_mode(m, lg, sm);
+        }
+        bench_sink = found;
+      }
+  });
+  printf("mos_bench: %d scales\n", 63 * 64 / 2);
+  printf("  build steps:        old %9.0f us, new %9.0f us, %.1fx\n",
+    old_build / 1000, new_build / 1000, old_build / new_build);
+  printf("  build + 140 keys:   old %9.0f us, new %9.0f us, %.1fx\n",
+    old_keys / 1000, new_keys / 1000, old_keys / new_keys);
+  return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+// the MOS generator as it was before src/MOS.h: recursive,
+// building a std::vector<bool> at every level, and its
+// inMode tables. kept as the reference the new generator
+// must match exactly.
+//
+// one change: the old gcd tried every factor below a and
+// so missed a itself (gcd(2,4) gave 1) and, for a = 0,
+// counted down from UINT_MAX. Euclid's gcd is used here so
+// the reference is right and runs in reasonable time; the
+// step words it builds are the same either way.
+#include <vector>
+#include <algorithm>
+
+uint reference_gcd(uint _a, uint _b) {
+  while (_b) {
+    uint _r = _a % _b;
+    _a = _b;
+    _b = _r;
+  }
+  return _a;
+}
+
+struct Reference_MOS_Scale {
+  std::vector<bool> steps;
+  // inMode[Mode #][Lg steps][Sm steps]
+  std::vector<std::vector<std::vector<bool>>> inMode;
+  std::vector<std::vector<bool>> inMode_EDO_equiv;
+  uint Lg;
+  uint Sm;
+  uint K; // GCD
+  uint G; // bright generator
+  uint modeCt;
+  bool rational;
+  uint underlyingEDO;
+
+  float ratio_f;
+  uint ratio_num_s;
+  uint ratio_den_L;
+
+  void determine_G_and_K() {
+    K = reference_gcd(Lg,Sm);
+    G = 0;
+    for (uint8_t m = 1; m < (Lg + Sm); ++m) {
+      if ((Sm * m) % (Lg + Sm) == 1) {
+        G = m;
+        break;
+      }
+    }
+    modeCt = (Lg + Sm) / K;
+  }
+
+  std::vector<bool> recursively_generate_MOS_scale(uint8_t L, uint8_t S) {
+    std::vector<bool> result;
+    if ((L == 1) || (S == 1)) {
+      for (uint8_t i = 0; i < L; ++i) {
+        result.emplace_back(true);
+      }
+      for (uint8_t i = 0; i < S; ++i) {
+        result.emplace_back(false);
+      }
+      return result;
+    } else {
+      int K = reference_gcd(L,S);
+      if (K > 1) {
+        result = recursively_generate_MOS_scale(L/K, S/K);
+        std::vector<bool> repeatKtimes;
+        for (uint8_t i = 0; i < K; ++i) {
+          for (uint8_t j = 0; j < result.size(); ++j) {
+            repeatKtimes.emplace_back(result[j]);
+          }
+        }
+        return repeatKtimes;
+      } else {
+        uint8_t Mn = (L < S ? L : S);
+        uint8_t Mx = (L > S ? L : S);
+        uint8_t z = Mx % Mn;
+        uint8_t w = Mn - z;
+        uint8_t v = Mx / Mn; // floor, integer division
+        std::vector<bool> preScale = recursively_generate_MOS_scale(z, w);
+        if (L < S) {
+          std::reverse(preScale.begin(), preScale.end());
+          for (uint8_t i = 0; i < preScale.size(); ++i) {
+            result.emplace_back(true);
+            for (uint8_t j = 0; j < v + preScale[i]; ++j) {
+              result.emplace_back(false);
+            }
+          }
+        } else {
+          for (uint8_t i = 0; i < preScale.size(); ++i) {
+            for (uint8_t j = 0; j < v + preScale[i]; ++j) {
+              result.emplace_back(true);
+            }
+            result.emplace_back(false);
+          }
+        }
+      }
+    }
+    return result;
+  }
+
+  Reference_MOS_Scale(int argL, int argS) : Lg(argL), Sm(argS) {
+    determine_G_and_K();
+    steps = recursively_generate_MOS_scale(Lg,Sm);
+  }
+
+  void set_L_S_ratio(uint n_s, uint d_l) {
+    rational = true;
+    ratio_num_s = n_s;
+    ratio_den_L = d_l;
+    ratio_f = (float)n_s / (float)d_l;
+    underlyingEDO = Sm * d_l + Lg * n_s;
+    inMode_EDO_equiv.resize(modeCt, 
+      std::vector<bool>(underlyingEDO, false));
+  }
+
+  std::vector<bool> get_mode(int mode) {
+    std::vector<bool> result;
+    for (uint8_t i = 0; i < (Lg + Sm); ++i) {
+      result.emplace_back(steps[(i + (G * mode)) % (Lg + Sm)]);
+    }
+    return result;
+  }  
+
+  void determine_key_colors() {
+    // initialize vector
+    inMode.resize(modeCt,
+      std::vector<std::vector<bool>>(Lg + 1,
+        std::vector<bool>(Sm + 1, false)
+    ));
+    int iL; // iterate # lg steps
+    int iS; // iterate # sm steps
+    for (uint8_t m = 0; m < modeCt; ++m) {
+      // traverse each mode of this scale
+      std::vector<bool> thisMode = get_mode(m);
+      iL = 0;
+      iS = 0;
+      for (uint8_t i = 0; i < Lg + Sm; ++i) {
+        // traverse each step in this mode
+        // and mark it TRUE
+        inMode[m][iL][iS] = true;
+        if (rational) {
+          inMode_EDO_equiv[m][iL * ratio_num_s + iS * ratio_den_L] = true;
+        }
+        iL +=  thisMode[i];
+        iS += !thisMode[i];
+      }
+    }
+  }
+};
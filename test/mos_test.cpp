@@ -0,0 +1,56 @@
+// src/MOS.h against the old recursive generator, for
+// every scale with 1 <= Lg, Sm and Lg + Sm <= 64: the
+// step word, the generator, the mode count, and which
+// notes are in each mode, also on the underlying EDO
+#include "check.h"
+#include "../src/MOS.h"
+#include "mos_reference.h"
+
+bool step_is_large(const MOS_Scale& mos, uint i) {
+  return (mos.steps[i >> 5] >> (i & 31)) & 1;
+}
+
+int main() {
+  int scales = 0;
+  for (uint Lg = 1; Lg < 64; ++Lg) {
+    for (uint Sm = 1; Lg + Sm <= 64; ++Sm) {
+      ++scales;
+      MOS_Scale mos(Lg, Sm);
+      Reference_MOS_Scale ref(Lg, Sm);
+      // a small-to-large ratio the layout menu could set
+      uint n_s = 1 + (Lg % 3);
+      uint d_l = n_s + 1 + (Sm % 2);
+      mos.set_L_S_ratio(n_s, d_l);
+      ref.set_L_S_ratio(n_s, d_l);
+      ref.determine_key_colors();
+
+      CHECK(ref.steps.size() == Lg + Sm);
+      bool same_steps = true;
+      for (uint i = 0; i < Lg + Sm; ++i) {
+        same_steps &= (step_is_large(mos, i) == ref.steps[i]);
+      }
+      if (!same_steps) printf("steps differ for %uL %us\n", Lg, Sm);
+      CHECK(same_steps);
+      CHECK(mos.K == ref.K);
+      CHECK(mos.G == ref.G);
+      CHECK(mos.modeCt == ref.modeCt);
+      CHECK(mos.underlyingEDO == ref.underlyingEDO);
+
+      bool same_modes = true;
+      for (uint m = 0; m < ref.modeCt; ++m) {
+        for (uint lg = 0; lg <= Lg; ++lg) {
+          for (uint sm = 0; sm <= Sm; ++sm) {
+            same_modes &= (mos.in_mode(m, lg, sm) == ref.inMode[m][lg][sm]);
+          }
+        }
+        for (uint d = 0; d < ref.underlyingEDO; ++d) {
+          same_modes &= (mos.in_mode_EDO_equiv(m, d) == ref.inMode_EDO_equiv[m][d]);
+        }
+      }
+      if (!same_modes) printf("modes differ for %uL %us\n", Lg, Sm);
+      CHECK(same_modes);
+    }
+  }
+  CHECK(scales == 63 * 64 / 2);
+  return finish("mos_test");
+}
@@ -0,0 +1,140 @@
+// the MPE sender, against the bytes it should send over
+// USB for a short recorded performance: zone setup, LRU
+// channels, cached bends and pressure, a stolen channel,
+// and a zone change with notes still held
+#include <vector>
+#include "check.h"
+#include "../src/debug.h"
+hexBoard_Debug_Object debug;
+#include "../src/latency.h"
+hexBoard_Latency_Object latency;
+#include "../src/MIDI_and_USB.h"
+#include "../src/hexBoard.h"
+#include "../src/MPE.h"
+
+void hardwired_switch_handler(int16_t) {}
+
+using Bytes = std::vector<uint8_t>;
+
+// everything sent since the last call
+Bytes sent() {
+  for (int i = 0; i < 8; ++i) {
+    host_timer.timerawl += USB_MIDI_max_hold_uS;
+    drain_MIDI_output();
+  }
+  Bytes result = host_usb_midi_out;
+  host_usb_midi_out.clear();
+  return result;
+}
+
+bool expect(const Bytes& got, const Bytes& want) {
+  if (got == want) return true;
+  printf("  sent:    ");
+  for (auto b : got) printf(" %02X", b);
+  printf("\n  expected:");
+  for (auto b : want) printf(" %02X", b);
+  printf("\n");
+  return false;
+}
+
+const int keys = 6;
+Button_Layout_Data layout[keys];
+Button_Play_State  play[keys];
+Button_LED_Codes   LED[keys];
+Button key(int k) { return {layout[k], play[k], LED[k]}; }
+
+void press(hexBoard_Setting_Array& s, hexBoard_MPE_Object& mpe, int k) {
+  play[k].velocity = 127;
+  play[k].pressure = 127;
+  mpe.note_on(s, key(k));
+}
+
+int main() {
+  hexBoard_Setting_Array s;
+  load_factory_defaults_to(s);
+  s[_MIDIusb].b  = true;
+  s[_MIDIjack].b = false;
+  s[_MPEzoneC].i = _MPEzone_lower;
+  s[_MPEzoneL].i = 4;  // member channels 2 to 4
+  s[_MPEpb].i    = 48;
+
+  const uint8_t note[keys] = {60, 64, 67, 60, 72, 62};
+  const int16_t bend[keys] = { 0, 100,  0,  0, -50, 0};
+  for (int k = 0; k < keys; ++k) {
+    layout[k].pixel    = k;
+    layout[k].coord    = {(int8_t)(2 * k - 6), 0};
+    layout[k].isNote   = true;
+    layout[k].midiNote = note[k];
+    layout[k].midiBend = bend[k];
+  }
+
+  hexBoard_MPE_Object mpe;
+  mpe.configure(s);
+  CHECK(expect(sent(), {
+    0xB0, 101, 0, 0xB0, 100, 6, 0xB0, 6, 3, 0xB0, 38, 0,   // zone: 3 members
+    0xB1, 101, 0, 0xB1, 100, 0, 0xB1, 6, 48, 0xB1, 38, 0,  // bend range, ch 2
+    0xB2, 101, 0, 0xB2, 100, 0, 0xB2, 6, 48, 0xB2, 38, 0,  // ch 3
+    0xB3, 101, 0, 0xB3, 100, 0, 0xB3, 6, 48, 0xB3, 38, 0,  // ch 4
+  }));
+
+  // first notes: the bend goes first on a fresh channel
+  press(s, mpe, 0);
+  press(s, mpe, 1);
+  CHECK(expect(sent(), {
+    0xE1, 0x00, 0x40, 0x91, 60, 127,   // ch 2, no bend
+    0xE2, 0x64, 0x40, 0x92, 64, 127,   // ch 3, bend +100
+  }));
+  CHECK(play[0].midiChPlaying == 2);
+  CHECK(play[1].midiChPlaying == 3);
+
+  // pressure is channel pressure, capped at 127, and not repeated
+  play[0].pressure = 90;
+  mpe.pressure(s, key(0));
+  mpe.pressure(s, key(0));
+  play[0].pressure = 200;
+  mpe.pressure(s, key(0));
+  CHECK(expect(sent(), {0xD1, 90, 0xD1, 127}));
+
+  // a released channel is reused last; a cached bend is not resent
+  mpe.note_off(s, key(0));
+  press(s, mpe, 2);   // ch 4, never used
+  press(s, mpe, 3);   // ch 2, the only idle one, bend already 0
+  CHECK(expect(sent(), {
+    0x81, 60, 0,
+    0xE3, 0x00, 0x40, 0x93, 67, 127,
+    0x91, 60, 127,
+  }));
+
+  // no idle channel: the oldest note (key 1 on ch 3) is ended
+  press(s, mpe, 4);
+  CHECK(expect(sent(), {
+    0x82, 64, 0,
+    0xE2, 0x4E, 0x3F, 0x92, 72, 127,   // bend -50
+  }));
+  CHECK(play[4].midiChPlaying == 3);
+  // the stolen key's release and pressure go nowhere
+  play[1].pressure = 50;
+  mpe.pressure(s, key(1));
+  mpe.note_off(s, key(1));
+  CHECK(expect(sent(), {}));
+  CHECK(play[1].midiChPlaying == 0);
+
+  // a zone change ends the held notes before resetting
+  s[_MPEzoneC].i = _MPEzone_upper;
+  s[_MPEzoneR].i = 14;  // member channels 14 and 15
+  s[_MPEpb].i    = 2;
+  mpe.configure(s);
+  CHECK(expect(sent(), {
+    0x81, 60, 0, 0x82, 72, 0, 0x83, 67, 0,
+    0xBF, 101, 0, 0xBF, 100, 6, 0xBF, 6, 2, 0xBF, 38, 0,   // zone: 2 members
+    0xBD, 101, 0, 0xBD, 100, 0, 0xBD, 6, 2, 0xBD, 38, 0,   // ch 14
+    0xBE, 101, 0, 0xBE, 100, 0, 0xBE, 6, 2, 0xBE, 38, 0,   // ch 15
+  }));
+  // and the keys still down no longer own a channel
+  mpe.note_off(s, key(4));
+  CHECK(expect(sent(), {}));
+
+  press(s, mpe, 5);
+  CHECK(expect(sent(), {0xED, 0x00, 0x40, 0x9D, 62, 127}));
+  return finish("mpe_test");
+}
@@ -0,0 +1,68 @@
+// the synth note-on before and after the per-key voice
+// start record, in CPU cycles per note. the old path works
+// out the pitch, DDS step, loudness and envelope in double
+// at note-on and copies the wavetable into the voice (or
+// in hybrid mode builds one); the new one copies the
+// key's ready-made record into the voice.
+//
+// on the board the same stage is timed off SysTick: send
+// "L" over serial and read the "note-on" line.
+#include "bench.h"
+#include "../src/latency.h"
+hexBoard_Latency_Object latency;
+#include "../src/hexBoard.h"
+#include "note_on_reference.h"
+
+void hardwired_switch_handler(int16_t) {}
+
+hexBoard_Grid_Object grid(hexBoard_layout_v1_2, hexBoard_lookup_v1_2);
+const int voices = 16;
+Synth_Voice voice[voices];
+old_note_on::Synth_Voice old_voice[voices];
+old_note_on::wave_tbl old_cached_waveform;
+Synth_Envelope envelope;
+
+// 128 keys, one per MIDI note, as layout_stage_synth would fill them
+Synth_Voice_Start start[128];
+double frequency[128];
+
+Synth_Voice_Start voice_start_at(cents_fx pitch, int volume, bool hybrid) {
+  Synth_Voice_Start s;
+  s.increment = cents_fx_to_increment(pitch);
+  uint32_t Hz = increment_to_Hz(s.increment);
+  s.loudness  = volume * iso226(Hz);
+  s.wavetable = (hybrid ? hybrid_wave_bank_index(Hz) + 1 : 0);
+  return s;
+}
+
+int main() {
+  build_hybrid_wave_bank(grid.hybrid_bank);
+  envelope.set(20, 50, 128, 100);
+  for (auto& v : voice) { v.ownership = -1; }
+  const int volume = 64;
+  const uint8_t velocity = 127;
+
+  for (bool hybrid : {false, true}) {
+    for (int n = 0; n < 128; ++n) {
+      start[n] = voice_start_at(n * cents_fx_per_semitone, volume, hybrid);
+      frequency[n] = 440.0 * exp2((n - 69.0) / 12.0);
+    }
+    double old_cycles = best_cycles(20, 128, [&](int n) {
+      old_note_on::note_on(&old_voice[n % voices], frequency[n], velocity,
+        hybrid, volume, old_cached_waveform);
+    });
+    double new_cycles = best_cycles(20, 128, [&](int n) {
+      const Synth_Voice_Start& s = start[n];
+      voice[n % voices].note_on(grid.wavetable(s.wavetable), s.increment,
+        (s.loudness * velocity) >> 15, envelope);
+    });
+    bench_sink = voice[5].pitch_as_increment + old_voice[5].pitch_as_increment;
+    if (!BENCH_HAS_CYCLES) {
+      printf("note_on_bench: no cycle counter on this host\n");
+      return 0;
+    }
+    printf("note_on_bench: %s wave: old %6.0f cycles, new %4.0f cycles, %.0fx\n",
+      hybrid ? "hybrid" : "cached", old_cycles, new_cycles, old_cycles / new_cycles);
+  }
+  return 0;
+}
@@ -0,0 +1,183 @@
+#pragma once
+// the synth note-on as it was before the per-key voice
+// start record: pitch, DDS step, loudness, wavetable and
+// envelope all worked out at note-on, in double, with the
+// wavetable copied into the voice. from the old
+// interpret_key_msg, music.h and synth.h, in a namespace
+// so it can sit beside the current code.
+#include <cmath>
+#include <array>
+#include "../src/config.h"
+
+namespace old_note_on {
+
+using wave_tbl = std::array<int8_t, 256>;
+
+const float f_hyb_square   =  220.f;
+const float f_hyb_saw_low  =  440.f;
+const float f_hyb_saw_high =  880.f;
+const float f_hyb_triangle = 1760.f;
+enum class Linear_Wave {square, saw, triangle, hybrid};
+
+wave_tbl linear_waveform(double _f, Linear_Wave _shp, uint8_t _mod) {
+  Linear_Wave m_shp = _shp;
+  float t_pct = 0.f;
+  if (_shp == Linear_Wave::hybrid) {
+    if (_f < f_hyb_saw_low) {
+      m_shp = Linear_Wave::square;
+      if (_f > f_hyb_square) {
+        t_pct =  (_f - f_hyb_square) / (f_hyb_saw_low - f_hyb_square);
+      }
+    } else if (_f > f_hyb_saw_high) {
+      m_shp = Linear_Wave::triangle;
+      if (_f < f_hyb_triangle) {
+        t_pct = (f_hyb_triangle - _f) / (f_hyb_triangle - f_hyb_saw_high);
+      }
+    } else {
+      m_shp = Linear_Wave::saw;
+    }
+  }
+  uint8_t d_cyc = 127 - _mod;
+  uint8_t a = 0;
+  uint8_t b = 0;
+  uint8_t c = 0;
+  uint8_t d = 0;
+  switch (m_shp) {
+    case Linear_Wave::square: {
+      a = (d_cyc * (1.f - t_pct)) - 1;
+      b = (d_cyc * (1.f + t_pct));
+      c = (d_cyc << 1) - 1;
+      d = c + 1;
+      break;
+    }
+    case Linear_Wave::saw: {
+      a =  0;
+      b = (d_cyc << 1) - 1;
+      c = (d_cyc << 1) - 1;
+      d = c + 1;
+      break;
+    }
+    case Linear_Wave::triangle: {
+      a =  0;
+      b =  d_cyc * (2.f - t_pct);
+      c =  b;
+      d = (d_cyc << 1);
+      break;
+    }
+    default: break;
+  }
+  wave_tbl result;
+  for (uint8_t i = 0; i <= a; ++i) {
+    result[i] = -127;
+  }
+  if (a < b - 1) {
+    for (uint8_t i = a + 1; i <= b - 1; ++i) {
+      result[i] = (((i - a) * ((254 << 8) / (b - 1 - a))) >> 8) - 127;
+    }
+  }
+  for (uint8_t i = b; i <= c; ++i) {
+    result[i] = 127;
+  }
+  if (c < d - 1) {
+    for (uint8_t i = c + 1; i <= d - 1; ++i) {
+      result[i] = (((d - i) * ((254 << 8) / (d - 1 - c))) >> 8) - 127;
+    }
+  }
+  return result;
+}
+
+uint32_t frequency_to_interval(double frequency, uint32_t interval_in_uS) {
+  return lround(ldexp(frequency * interval_in_uS / 1000000.0, 32));
+}
+
+uint8_t iso226(double f) {
+  if (f <      8.0) return 0;
+  if (f <    200.0) return 255;
+  if (f <   1500.0) return 191 + ldexp(std::abs(f- 800) /  700.0, 6);
+  if (f <   5000.0) return 127 + ldexp(std::abs(f-3250) / 1750.0, 7);
+  if (f < highest_MIDI_note_Hz) return 255;
+  return 0;
+}
+
+double frequency_after_pitch_bend(double base_frequency,
+    int16_t global_pitch_bend, uint8_t pitch_bend_range_in_semitones) {
+  return base_frequency
+       * exp2(ldexp(global_pitch_bend
+       * pitch_bend_range_in_semitones / 3.0,
+        -15));
+}
+
+struct Synth_Voice {
+  int8_t wavetable[256];
+  uint32_t pitch_as_increment;
+  uint8_t base_volume;
+  uint32_t attack;
+  uint32_t decay;
+  uint8_t sustain;
+  uint32_t release;
+  uint32_t loop_counter;
+  int32_t envelope_counter;
+  uint8_t envelope_level;
+  uint8_t phase;
+  uint32_t attack_inverse;
+  uint32_t decay_inverse;
+  uint32_t release_inverse;
+  volatile uint8_t ownership = 255;
+
+  void update_wavetable(const wave_tbl& tbl) {
+    while (ownership == 1) {}
+    ownership = 0;
+    for (size_t i = 0; i <  256; ++i) {
+      wavetable[i] = tbl[i];
+    }
+    ownership = -1;
+  }
+  void update_pitch(uint32_t increment) {
+    while (ownership == 1) {}
+    ownership = 0;
+    pitch_as_increment = increment;
+    ownership = -1;
+  }
+  void update_base_volume(uint8_t volume) {
+    while (ownership == 1) {}
+    ownership = 0;
+    base_volume = volume;
+    ownership = -1;
+  }
+  void update_envelope(uint32_t a, uint32_t d, uint8_t s, uint32_t r) {
+    while (ownership == 1) {}
+    ownership = 0;
+    attack = a * 1000 / audio_sample_interval_uS;
+    decay = d * 1000 / audio_sample_interval_uS;
+    sustain = s;
+    release = r * 1000 / audio_sample_interval_uS;
+    attack_inverse  = !attack ? 0 : 0xFFFFFFFF / attack;
+    decay_inverse   = !decay ? 0 : ((256 - sustain) << 24) / decay;
+    release_inverse = !release ? 0 : (sustain << 24) / release;
+    ownership = -1;
+  }
+  void note_on() {
+    while (ownership == 1) {}
+    ownership = 0;
+    envelope_counter = 0;
+    phase = 1;
+    ownership = -1;
+  }
+};
+
+// the synth part of the old note-on, for the "hit" envelope
+void note_on(Synth_Voice* v, double frequency, uint8_t velocity,
+             bool hybrid, int volume, const wave_tbl& cached_waveform) {
+  double adj_f = frequency_after_pitch_bend(frequency, 0 /*pb*/, 2 /*pb range*/);
+  v->update_pitch(frequency_to_interval(adj_f, audio_sample_interval_uS));
+  if (hybrid) {
+    v->update_wavetable(linear_waveform(adj_f, Linear_Wave::hybrid, 0 /*mod*/));
+  } else {
+    v->update_wavetable(cached_waveform);
+  }
+  v->update_base_volume((volume * velocity * iso226(adj_f)) >> 15);
+  v->update_envelope(20/*ms*/, 50/*ms*/, 128/*0-255*/, 100/*ms*/);
+  v->note_on();
+}
+
+}
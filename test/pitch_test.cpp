@@ -0,0 +1,67 @@
+// the fixed-point pitch math in music.h against the
+// same sums done in double, over the whole MIDI range
+#include <cmath>
+#include "check.h"
+#include "../src/music.h"
+
+// the DDS step the double code used to compute
+double reference_increment(cents_fx pitch) {
+  double Hz = 440.0 * exp2((cents_fx_to_MIDI(pitch) - 69.0) / 12.0);
+  return Hz * audio_sample_interval_uS / 1'000'000.0 * 4294967296.0;
+}
+
+double error_in_cents(uint32_t increment, double reference) {
+  return std::fabs(1200.0 * std::log2(increment / reference));
+}
+
+int main() {
+  // the exp2 table is within one step of its last bit
+  for (int i = 0; i <= 256; ++i) {
+    double exact = std::exp2(i / 256.0) * (1u << 30);
+    CHECK(std::fabs(exp2_Q30.v[i] - exact) <= 1.0);
+  }
+
+  // pitch to step: within 0.005 cents, much less than
+  // anyone can hear, from MIDI note 0 to the top of 127
+  double worst = 0;
+  cents_fx worst_at = 0;
+  for (cents_fx p = 0; p <= 128 * cents_fx_per_semitone; p += 977) {
+    double err = error_in_cents(cents_fx_to_increment(p), reference_increment(p));
+    if (err > worst) {
+      worst = err;
+      worst_at = p;
+    }
+  }
+  printf("  worst step error %.5f cents at MIDI %.3f\n", worst, cents_fx_to_MIDI(worst_at));
+  CHECK(worst < 0.005);
+  // every whole note, where the table needs no interpolation
+  for (int note = 0; note <= 127; ++note) {
+    cents_fx p = note * cents_fx_per_semitone;
+    CHECK(error_in_cents(cents_fx_to_increment(p), reference_increment(p)) < 0.005);
+  }
+  // below note 0 is held at note 0
+  CHECK(cents_fx_to_increment(-5) == cents_fx_to_increment(0));
+
+  // step back to Hz, in whole Hz
+  CHECK(increment_to_Hz(cents_fx_to_increment(6900 << cents_fx_bits)) == 440);
+  for (int note = 0; note <= 127; ++note) {
+    double Hz = 440.0 * exp2((note - 69.0) / 12.0);
+    uint32_t got = increment_to_Hz(cents_fx_to_increment(note * cents_fx_per_semitone));
+    CHECK(std::fabs(got - Hz) <= 1.0);
+  }
+
+  // pitch bend is exact: bend / 8192 * range semitones
+  for (int range = 1; range <= 96; range *= 2) {
+    for (int bend = -8192; bend <= 8191; bend += 127) {
+      double cents = bend / 8192.0 * range * 100.0;
+      cents_fx got = pitch_after_pitch_bend(6000 << cents_fx_bits, bend, range);
+      CHECK(got == (6000 << cents_fx_bits) + std::lround(cents * (1 << cents_fx_bits)));
+    }
+  }
+
+  // MIDI to fixed point and back, to within rounding
+  for (double midi = 0; midi < 128; midi += 0.0371) {
+    CHECK(std::fabs(cents_fx_to_MIDI(MIDI_to_cents_fx(midi)) - midi) <= 0.5 / cents_fx_per_semitone);
+  }
+  return finish("pitch_test");
+}
@@ -0,0 +1,268 @@
+// the settings file: a save and load round trip, update
+// blocks, files cut short by a power loss, damage, and
+// migration from the old headerless format
+#include "check.h"
+#include "../src/debug.h"
+hexBoard_Debug_Object debug;
+#include "../src/file_system.h"
+
+const char* FN = "settings.dat";
+
+bool same_values(hexBoard_Setting_Array& a, hexBoard_Setting_Array& b) {
+  for (size_t i = 0; i < _settingSize; ++i) {
+    if ((i == _defaults) || (i == _changed)) continue;
+    if (a[i].w != b[i].w) {
+      printf("  setting %zu differs\n", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+void change_some(hexBoard_Setting_Array& s, int by) {
+  s[_anchorN].i  = 60 + by;
+  s[_equaveC].d  = 1200.0 + 0.5 * by;
+  s[_scaleLck].b = (by & 1);
+  s[_synthWav].i = by % 4;
+  s[_MPEpb].i    = 48 - by;
+}
+
+// a fresh array that differs from whatever is saved
+void reset(hexBoard_Setting_Array& s) {
+  load_factory_defaults_to(s);
+  s[_anchorX].i = 99;
+}
+
+std::vector<uint8_t>& file() { return LittleFS.files[FN]; }
+
+void test_round_trip() {
+  hexBoard_Setting_Array a, b;
+  load_factory_defaults_to(a);
+  change_some(a, 7);
+  a[_changed].b = true;
+  CHECK(save_settings(a, FN));
+  CHECK(!a[_changed].b);
+  CHECK(!LittleFS.exists("settings.dat.tmp"));
+  CHECK(file().size() == settings_file_header_size + 1 + _settingSize * settings_record_size + 4);
+  CHECK(settings_file_size == file().size());
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(a, b));
+  CHECK(!b[_defaults].b);
+  CHECK(!b[_changed].b);
+  CHECK(settings_file_size == file().size());
+}
+
+void test_updates() {
+  hexBoard_Setting_Array a, b;
+  load_factory_defaults_to(a);
+  a[_changed].b = true;
+  CHECK(save_settings(a, FN));
+  size_t whole = file().size();
+  hexBoard_Settings_Saver saver;
+
+  // one change is appended as one record, after the delay, when quiet
+  host_timer.timerawl = 1000;
+  a[_anchorN].i = 62;
+  saver.mark(a, _anchorN);
+  saver.poll(a, FN, true);
+  CHECK(file().size() == whole); // too soon
+  host_timer.timerawl += settings_save_delay_uS;
+  saver.poll(a, FN, false);
+  CHECK(file().size() == whole); // not quiet
+  saver.poll(a, FN, true);
+  CHECK(file().size() == whole + 1 + settings_record_size + 4);
+  CHECK(saver.updates == 1);
+  CHECK(!a[_changed].b);
+
+  // later updates override earlier ones when loaded
+  for (int n = 0; n < 5; ++n) {
+    change_some(a, n);
+    saver.mark(a, _anchorN);
+    saver.mark(a, _equaveC);
+    saver.mark(a, _scaleLck);
+    saver.mark(a, _synthWav);
+    saver.mark(a, _MPEpb);
+    host_timer.timerawl += settings_save_delay_uS;
+    saver.poll(a, FN, true);
+  }
+  CHECK(saver.updates == 6);
+  CHECK(saver.rewrites == 0);
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(a, b));
+
+  // once the file would outgrow the buffer it is rewritten whole
+  for (int n = 0; n < 200; ++n) {
+    change_some(a, n);
+    for (size_t i = 2; i < _settingSize; ++i) saver.mark(a, i);
+    host_timer.timerawl += settings_save_delay_uS;
+    saver.poll(a, FN, true);
+  }
+  CHECK(saver.rewrites > 0);
+  CHECK(saver.failures == 0);
+  CHECK(file().size() <= settings_file_max_size);
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(a, b));
+
+  // a menu reset asks for the whole file
+  load_factory_defaults_to(a);
+  saver.mark_all(a);
+  host_timer.timerawl += settings_save_delay_uS;
+  uint32_t rewrites = saver.rewrites;
+  saver.poll(a, FN, true);
+  CHECK(saver.rewrites == rewrites + 1);
+  CHECK(file().size() == whole);
+}
+
+void test_power_cuts() {
+  hexBoard_Setting_Array a, b, before;
+  load_factory_defaults_to(a);
+  change_some(a, 1);
+  a[_changed].b = true;
+  CHECK(save_settings(a, FN));
+  before = a;
+  size_t whole = file().size();
+
+  // an update cut short is dropped, and the next save rewrites
+  bool dirty[_settingSize] = {};
+  change_some(a, 2);
+  dirty[_anchorN] = dirty[_equaveC] = true;
+  LittleFS.write_budget = 10;
+  CHECK(!append_settings_update(a, FN, dirty));
+  LittleFS.write_budget = SIZE_MAX;
+  CHECK(file().size() == whole + 10);
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(before, b));
+  CHECK(settings_file_size == 0);
+  CHECK(!append_settings_update(a, FN, dirty));
+  a[_changed].b = true;
+  CHECK(save_settings(a, FN));
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(a, b));
+
+  // a whole-file save cut short leaves the old file alone
+  hexBoard_Setting_Array saved = a;
+  change_some(a, 3);
+  a[_changed].b = true;
+  LittleFS.write_budget = 100;
+  CHECK(!save_settings(a, FN));
+  LittleFS.write_budget = SIZE_MAX;
+  CHECK(!LittleFS.exists("settings.dat.tmp"));
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(saved, b));
+
+  // an empty file counts as no file
+  file().clear();
+  reset(b);
+  hexBoard_Setting_Array untouched = b;
+  CHECK(!load_settings(b, FN));
+  CHECK(b[_defaults].b);
+  CHECK(same_values(untouched, b));
+
+  // so does a missing one
+  LittleFS.remove(FN);
+  CHECK(!load_settings(b, FN));
+  CHECK(same_values(untouched, b));
+
+  // a new-format file cut short anywhere is not loaded
+  CHECK(save_settings(a, FN));
+  std::vector<uint8_t> good = file();
+  for (size_t len : {size_t(1), settings_file_header_size, settings_file_header_size + 1,
+                     good.size() / 2, good.size() - 1}) {
+    file().assign(good.begin(), good.begin() + len);
+    reset(b);
+    CHECK(!load_settings(b, FN));
+    CHECK(same_values(untouched, b));
+  }
+
+  // nor is one with a byte changed
+  file() = good;
+  file()[20] ^= 0x55;
+  reset(b);
+  CHECK(!load_settings(b, FN));
+  CHECK(same_values(untouched, b));
+}
+
+void test_records_by_ID() {
+  hexBoard_Setting_Array a, b;
+  load_factory_defaults_to(a);
+  change_some(a, 4);
+  a[_changed].b = true;
+  CHECK(save_settings(a, FN));
+  // a record from a newer firmware, with an ID this one does not know
+  std::vector<uint8_t>& f = file();
+  f.resize(f.size() - 4);
+  size_t countAt = settings_file_header_size;
+  f[countAt] += 1;
+  f.push_back(250);
+  for (int i = 0; i < 8; ++i) f.push_back(0xAA);
+  uint32_t crc = crc32(f.data(), f.size());
+  f.insert(f.end(), (uint8_t*)&crc, (uint8_t*)&crc + 4);
+  reset(b);
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(a, b));
+}
+
+// the old file: one 8 byte value per setting in ID order, no header
+std::vector<uint8_t> legacy_file(hexBoard_Setting_Array& s) {
+  std::vector<uint8_t> f(legacy_settings_file_size, 0);
+  for (size_t i = 0; i < _settingSize; ++i) {
+    if (setting_ID[i] >= 68) continue;
+    memcpy(f.data() + setting_ID[i] * bytes_per_setting, s[i].w.data(), bytes_per_setting);
+  }
+  return f;
+}
+
+void test_legacy_migration() {
+  hexBoard_Setting_Array a, b, c;
+  load_factory_defaults_to(a);
+  change_some(a, 5);
+  a[_defaults].b = false;
+  file() = legacy_file(a);
+  reset(b);
+  hexBoard_Setting_Array expected = b;
+  for (size_t i = 0; i < _settingSize; ++i) {
+    // settings the old file did not have keep their defaults
+    if (setting_ID[i] < 68) expected[i] = a[i];
+  }
+  CHECK(load_settings(b, FN));
+  CHECK(same_values(expected, b));
+  CHECK(b[_anchorN].i == a[_anchorN].i);
+  CHECK(b[_equaveC].d == a[_equaveC].d);
+  CHECK(b[_scaleLck].b == a[_scaleLck].b);
+  CHECK(!b[_defaults].b);
+  CHECK(b[_changed].b); // to be rewritten in the new format
+  CHECK(settings_file_size == 0);
+
+  // then saved in the new format and read back the same
+  CHECK(save_settings(b, FN));
+  CHECK(!memcmp(file().data(), settings_file_header, settings_file_header_size));
+  reset(c);
+  CHECK(load_settings(c, FN));
+  CHECK(same_values(b, c));
+
+  // a headerless file of any other length is not trusted
+  for (size_t len : {legacy_settings_file_size - 8, legacy_settings_file_size + 8, size_t(3)}) {
+    file() = legacy_file(a);
+    file().resize(len);
+    reset(b);
+    hexBoard_Setting_Array untouched = b;
+    CHECK(!load_settings(b, FN));
+    CHECK(same_values(untouched, b));
+  }
+}
+
+int main() {
+  fileSystemExists = true;
+  test_round_trip();
+  test_updates();
+  test_power_cuts();
+  test_records_by_ID();
+  test_legacy_migration();
+  return finish("settings_test");
+}
@@ -0,0 +1,25 @@
+#pragma once
+// USB MIDI as seen by the firmware. every byte handed to
+// TinyUSB is kept in host_usb_midi_out for a test to read.
+#include <Arduino.h>
+#include <vector>
+
+struct Adafruit_USBD_MIDI {
+  void begin(unsigned long) {}
+  void setStringDescriptor(const char*) {}
+  int  available() { return 0; }
+  int  read() { return -1; }
+};
+struct Adafruit_USBD_Device {
+  bool mounted() { return true; }
+};
+inline Adafruit_USBD_Device TinyUSBDevice;
+
+inline std::vector<uint8_t> host_usb_midi_out;
+inline bool host_usb_mounted = true;
+inline bool tud_midi_mounted() { return host_usb_mounted; }
+inline uint32_t tud_midi_stream_write(uint8_t, const uint8_t* data, uint32_t n) {
+  if (!host_usb_mounted) return 0;
+  host_usb_midi_out.insert(host_usb_midi_out.end(), data, data + n);
+  return n;
+}
@@ -0,0 +1,42 @@
+#pragma once
+// just enough of the Arduino core to build firmware
+// headers on the host. Serial output is kept in a
+// string so a test can read it back.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define LOW          0
+#define HIGH         1
+
+// every pin reads back this level
+inline int host_pin_level = HIGH;
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int  digitalRead(int) { return host_pin_level; }
+inline int  analogRead(int)  { return host_pin_level ? 4095 : 0; }
+
+struct HardwareSerial {
+  std::string out;
+  void begin(unsigned long) {}
+  size_t print(const char* s)   { out += s; return strlen(s); }
+  size_t print(long n)          { return print(std::to_string(n).c_str()); }
+  size_t println(const char* s = "") { size_t n = print(s); out += "\n"; return n + 1; }
+  size_t println(long n)        { return println(std::to_string(n).c_str()); }
+  size_t write(uint8_t b)       { out += (char)b; return 1; }
+  int  availableForWrite()      { return 64; }
+  int  available()              { return 0; }
+  int  read()                   { return -1; }
+  void flush()                  {}
+};
+inline HardwareSerial Serial;
+inline HardwareSerial Serial1;
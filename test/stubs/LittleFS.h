@@ -0,0 +1,72 @@
+#pragma once
+// LittleFS held in memory. A test can make the flash
+// fill up after some number of bytes, as a power cut
+// part way through a write would leave it.
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Host_FS;
+
+class File {
+ public:
+  File() {}
+  File(Host_FS* fs, const std::string& name, size_t pos)
+    : fs(fs), name(name), pos(pos) {}
+  operator bool() const { return fs != nullptr; }
+  size_t read(uint8_t* buf, size_t size);
+  size_t write(const uint8_t* buf, size_t size);
+  void close() { fs = nullptr; }
+ private:
+  Host_FS* fs = nullptr;
+  std::string name;
+  size_t pos = 0;
+};
+
+struct Host_FS {
+  std::map<std::string, std::vector<uint8_t>> files;
+  size_t write_budget = SIZE_MAX; // bytes left before the power goes
+
+  bool begin()  { return true; }
+  bool format() { files.clear(); return true; }
+  bool exists(const char* path) { return files.count(path) > 0; }
+  File open(const char* path, const char* mode) {
+    if (mode[0] == 'r') {
+      if (!files.count(path)) return File();
+      return File(this, path, 0);
+    }
+    if (mode[0] == 'w') files[path].clear();
+    return File(this, path, files[path].size());
+  }
+  bool rename(const char* from, const char* to) {
+    if (!files.count(from)) return false;
+    files[to] = files[from];
+    files.erase(from);
+    return true;
+  }
+  bool remove(const char* path) { return files.erase(path) > 0; }
+};
+inline Host_FS LittleFS;
+
+inline size_t File::read(uint8_t* buf, size_t size) {
+  if (!fs) return 0;
+  std::vector<uint8_t>& f = fs->files[name];
+  size_t n = (pos < f.size() ? std::min(size, f.size() - pos) : 0);
+  memcpy(buf, f.data() + pos, n);
+  pos += n;
+  return n;
+}
+
+inline size_t File::write(const uint8_t* buf, size_t size) {
+  if (!fs) return 0;
+  std::vector<uint8_t>& f = fs->files[name];
+  size_t n = std::min(size, fs->write_budget);
+  fs->write_budget -= n;
+  if (f.size() < pos + n) f.resize(pos + n);
+  memcpy(f.data() + pos, buf, n);
+  pos += n;
+  return n;
+}
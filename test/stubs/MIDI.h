@@ -0,0 +1,77 @@
+#pragma once
+// the send side of the Arduino MIDI Library, byte for byte:
+// status with the channel, 7-bit data, pitch bend offset to
+// 0..16383 and sent LSB first, and running status if the
+// settings ask for it. nothing is ever received.
+#include <Arduino.h>
+
+#define MIDI_CHANNEL_OMNI 0
+#define MIDI_CHANNEL_OFF  17
+
+namespace midi {
+typedef uint8_t Channel;
+typedef uint8_t DataByte;
+enum MidiType : uint8_t {
+  InvalidType       = 0x00,
+  NoteOff           = 0x80,
+  NoteOn            = 0x90,
+  AfterTouchPoly    = 0xA0,
+  ControlChange     = 0xB0,
+  ProgramChange     = 0xC0,
+  AfterTouchChannel = 0xD0,
+  PitchBend         = 0xE0,
+  SystemExclusive   = 0xF0,
+  SystemExclusiveEnd = 0xF7
+};
+struct DefaultSettings {
+  static const bool UseRunningStatus = false;
+};
+
+template <class Transport, class Settings = DefaultSettings>
+class MidiInterface {
+ public:
+  MidiInterface(Transport& t) : transport(t) {}
+  void begin(Channel = 1) { transport.begin(); }
+  bool read() { return false; }
+  void turnThruOff() {}
+  void setHandleNoteOn(void (*)(Channel, byte, byte)) {}
+  void setHandleNoteOff(void (*)(Channel, byte, byte)) {}
+
+  void sendNoteOn(DataByte note, DataByte velocity, Channel ch)  { send(NoteOn, note, velocity, ch); }
+  void sendNoteOff(DataByte note, DataByte velocity, Channel ch) { send(NoteOff, note, velocity, ch); }
+  void sendAfterTouch(DataByte pressure, Channel ch)             { send(AfterTouchChannel, pressure, 0, ch); }
+  void sendAfterTouch(DataByte note, DataByte pressure, Channel ch) { send(AfterTouchPoly, note, pressure, ch); }
+  void sendControlChange(DataByte cc, DataByte value, Channel ch) { send(ControlChange, cc, value, ch); }
+  void sendProgramChange(DataByte program, Channel ch)           { send(ProgramChange, program, 0, ch); }
+  void sendPitchBend(int value, Channel ch) {
+    unsigned bend = unsigned(value + 8192);
+    send(PitchBend, bend & 0x7f, (bend >> 7) & 0x7f, ch);
+  }
+  void sendSysEx(unsigned length, const byte* data, bool containsBoundaries = false) {
+    transport.beginTransmission(SystemExclusive);
+    if (!containsBoundaries) transport.write(SystemExclusive);
+    for (unsigned i = 0; i < length; ++i) transport.write(data[i]);
+    if (!containsBoundaries) transport.write(SystemExclusiveEnd);
+    transport.endTransmission();
+    runningStatus = InvalidType;
+  }
+
+ private:
+  void send(MidiType type, DataByte d1, DataByte d2, Channel ch) {
+    if ((ch == 0) || (ch >= MIDI_CHANNEL_OFF)) return;
+    byte status = type | ((ch - 1) & 0x0f);
+    transport.beginTransmission(type);
+    if (!Settings::UseRunningStatus || (runningStatus != status)) {
+      transport.write(status);
+      runningStatus = status;
+    }
+    transport.write(d1 & 0x7f);
+    if ((type != ProgramChange) && (type != AfterTouchChannel)) {
+      transport.write(d2 & 0x7f);
+    }
+    transport.endTransmission();
+  }
+  Transport& transport;
+  byte runningStatus = InvalidType;
+};
+}
@@ -0,0 +1,13 @@
+#pragma once
+// the PWM audio outputs; nothing is played on the host
+#include <stdint.h>
+typedef struct { uint32_t csr, div, top; } pwm_config;
+#define GPIO_FUNC_PWM 4
+inline pwm_config pwm_get_default_config() { return pwm_config{0, 0, 0}; }
+inline void pwm_config_set_clkdiv(pwm_config*, float) {}
+inline void pwm_config_set_wrap(pwm_config*, uint16_t) {}
+inline void pwm_config_set_phase_correct(pwm_config*, bool) {}
+inline unsigned pwm_gpio_to_slice_num(unsigned pin) { return (pin >> 1) & 7; }
+inline void pwm_init(unsigned, pwm_config*, bool) {}
+inline void pwm_set_gpio_level(unsigned, uint16_t) {}
+inline void gpio_set_function(unsigned, unsigned) {}
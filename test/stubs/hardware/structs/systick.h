@@ -0,0 +1,6 @@
+#pragma once
+// the SysTick counter does not run on the host
+#include <stdint.h>
+struct systick_hw_t { volatile uint32_t csr, rvr, cvr, calib; };
+inline systick_hw_t host_systick = {0, 0, 0, 0};
+inline systick_hw_t* systick_hw = &host_systick;
@@ -0,0 +1,8 @@
+#pragma once
+// one host thread plays both cores; a test picks which
+#include <stdint.h>
+inline unsigned host_core = 0;
+inline unsigned get_core_num() { return host_core; }
+inline uint32_t save_and_disable_interrupts() { return 0; }
+inline void restore_interrupts(uint32_t) {}
+inline void __dmb() {}
@@ -0,0 +1,5 @@
+#pragma once
+// core1 is never running on the host, so there is nothing to park
+inline void multicore_lockout_victim_init() {}
+inline void multicore_lockout_start_blocking() {}
+inline void multicore_lockout_end_blocking() {}
@@ -0,0 +1,6 @@
+#pragma once
+// the free-running microsecond timer; a test sets the time
+#include <stdint.h>
+struct timer_hw_t { volatile uint32_t timerawl; volatile uint32_t timerawh; };
+inline timer_hw_t host_timer = {0, 0};
+inline timer_hw_t* timer_hw = &host_timer;
@@ -0,0 +1,36 @@
+#pragma once
+// a queue of fixed-size elements, as in the Pico SDK
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+struct queue_t {
+  unsigned element_size = 0;
+  unsigned capacity = 0;
+  std::deque<std::vector<uint8_t>> items;
+};
+inline void queue_init(queue_t* q, unsigned element_size, unsigned count) {
+  q->element_size = element_size;
+  q->capacity = count;
+  q->items.clear();
+}
+inline bool queue_try_add(queue_t* q, const void* data) {
+  if (q->items.size() >= q->capacity) return false;
+  const uint8_t* p = (const uint8_t*)data;
+  q->items.emplace_back(p, p + q->element_size);
+  return true;
+}
+// there is no other core to empty a full queue, so it drops instead
+inline void queue_add_blocking(queue_t* q, const void* data) {
+  queue_try_add(q, data);
+}
+inline bool queue_try_remove(queue_t* q, void* data) {
+  if (q->items.empty()) return false;
+  memcpy(data, q->items.front().data(), q->element_size);
+  q->items.pop_front();
+  return true;
+}
+inline unsigned queue_get_level(queue_t* q) { return q->items.size(); }
+inline bool queue_is_empty(queue_t* q) { return q->items.empty(); }
+inline bool queue_is_full(queue_t* q) { return q->items.size() >= q->capacity; }
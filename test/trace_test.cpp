@@ -0,0 +1,80 @@
+// the trace ring on both cores, sent by the firmware's
+// send() and turned back into text by tools/trace_decode
+#include <sstream>
+#include <vector>
+#include "check.h"
+#include "../src/debug.h"
+#define TRACE_DECODE_NO_MAIN
+#include "../tools/trace_decode.cpp"
+
+hexBoard_Debug_Object debug;
+
+std::vector<std::string> sent_and_decoded() {
+  std::vector<std::string> lines;
+  std::istringstream in(Serial.out);
+  std::string line, text;
+  while (std::getline(in, line)) {
+    decode_trace_line(line, text);
+    lines.push_back(text);
+  }
+  Serial.out.clear();
+  return lines;
+}
+
+void log_on(unsigned core, uint32_t time, uint16_t event, int32_t a = 0, int32_t b = 0) {
+  host_core = core;
+  host_timer.timerawl = time;
+  debug.trace(event, a, b);
+  host_core = 0;
+}
+
+int main() {
+  bool on = false;
+  debug.setStatus(&on);
+  log_on(0, 10, _trace_calibrated, 5);
+  debug.send();
+  CHECK(Serial.out.empty());
+
+  on = true;
+  // the cores log out of step; send() merges them in time order
+  log_on(1, 30, _trace_note_pitch, 60, 2);
+  log_on(0, 20, _trace_settings_saved, 1234);
+  log_on(1, 40, _trace_note_MOS, 3, 4);
+  log_on(0, 50, _trace_scala_loaded, 12);
+  debug.send();
+  auto lines = sent_and_decoded();
+  CHECK(lines.size() == 4);
+  if (lines.size() == 4) {
+    CHECK(lines[0] == "[20 c0] settings saved in 1234 uS");
+    CHECK(lines[1] == "[30 c1] note 60 tier 2");
+    CHECK(lines[2] == "[40 c1]   / 3L,4s");
+    CHECK(lines[3] == "[50 c0] Scala file loaded, 12 degrees");
+  }
+
+  // a full ring drops the newest records and says how many, once
+  for (uint32_t i = 0; i < trace_ring_size + 6; ++i) {
+    log_on(1, 100 + i, _trace_calibrated, i);
+  }
+  debug.send();
+  lines = sent_and_decoded();
+  CHECK(lines.size() == trace_ring_size + 1);
+  if (lines.size() == trace_ring_size + 1) {
+    CHECK(lines[0] == "[100 c1] calibrated 0 keys");
+    CHECK(lines[trace_ring_size - 1] == "[163 c1] calibrated 63 keys");
+    CHECK(lines[trace_ring_size] == "c1 trace ring full, 6 records dropped");
+  }
+  debug.send();
+  CHECK(Serial.out.empty());
+
+  // the timer wraps; order still follows the time difference
+  log_on(0, 0xFFFFFFF0u, _trace_preset_saved);
+  log_on(1, 0x00000010u, _trace_preset_empty);
+  debug.send();
+  lines = sent_and_decoded();
+  CHECK(lines.size() == 2);
+  if (lines.size() == 2) {
+    CHECK(lines[0] == "[4294967280 c0] preset saved");
+    CHECK(lines[1] == "[16 c1] Preset slot is empty.");
+  }
+  return finish("trace_test");
+}
@@ -0,0 +1,54 @@
+/*
+ *  Trace decoder, built and run on the host.
+ *  Reads what the HexBoard sends over serial and prints
+ *  it with each trace record turned back into text, in
+ *  the same words as the firmware's event table. Lines
+ *  that are not trace records (the L, E and S reports)
+ *  pass through unchanged.
+ *
+ *    g++ -std=c++17 -o trace_decode tools/trace_decode.cpp
+ *    cat /dev/ttyACM0 | ./trace_decode
+ */
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include "../src/trace_events.h"
+
+// turn one line from the board into text; true if it was a trace line
+bool decode_trace_line(const std::string& in, std::string& out) {
+  char text[160];
+  unsigned timestamp, core, event, dropped;
+  int a, b;
+  const char* s = in.c_str();
+  if (sscanf(s, TRACE_RECORD_PREFIX " %u %u %u %d %d",
+      &timestamp, &core, &event, &a, &b) == 5) {
+    int n = snprintf(text, sizeof(text), "[%u c%u] ", timestamp, core);
+    if (event < _trace_event_count) {
+      snprintf(text + n, sizeof(text) - n, trace_event_format[event], a, b);
+    } else {
+      snprintf(text + n, sizeof(text) - n, "unknown event %u (%d, %d)", event, a, b);
+    }
+    out = text;
+    return true;
+  }
+  if (sscanf(s, TRACE_DROPPED_PREFIX " %u %u", &core, &dropped) == 2) {
+    snprintf(text, sizeof(text), "c%u trace ring full, %u records dropped", core, dropped);
+    out = text;
+    return true;
+  }
+  out = in;
+  return false;
+}
+
+#ifndef TRACE_DECODE_NO_MAIN
+int main() {
+  std::string line, text;
+  while (std::getline(std::cin, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    decode_trace_line(line, text);
+    std::cout << text << '\n';
+  }
+  return 0;
+}
+#endif